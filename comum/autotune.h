@@ -0,0 +1,121 @@
+// Cache persistente de parâmetros de kernel, indexado pela "impressão
+// digital" do hardware (modelo da CPU + número de CPUs).
+//
+// Cada programa mantém seu próprio arquivo (ou AUTOTUNE_CACHE), uma linha
+// por host:
+//   <fingerprint> nome=valor nome=valor ...
+// Se não existe linha para o hardware atual, o programa deve refazer a
+// busca e gravar os vencedores com autotune_salvar.
+#ifndef AUTOTUNE_H
+#define AUTOTUNE_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <time.h>
+#include <unistd.h>
+
+#define AUTOTUNE_LINHA 1024
+
+// Um parâmetro ajustável; 'valor' começa com o padrão do programa
+typedef struct {
+    const char *nome;
+    int valor;
+} autotune_param_t;
+
+static inline double autotune_agora(void) {
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec + t.tv_nsec / 1e9;
+}
+
+// "modelo_da_cpu|n_cpus", sem espaços para caber num campo do cache
+static inline void autotune_fingerprint(char *buf, size_t tam) {
+    char modelo[256] = "desconhecido";
+    FILE *f = fopen("/proc/cpuinfo", "r");
+    if (f) {
+        char linha[512];
+        while (fgets(linha, sizeof(linha), f)) {
+            if (strncmp(linha, "model name", 10) == 0 || strncmp(linha, "Hardware", 8) == 0) {
+                char *v = strchr(linha, ':');
+                if (v) {
+                    v++;
+                    while (*v == ' ' || *v == '\t') v++;
+                    snprintf(modelo, sizeof(modelo), "%s", v);
+                    modelo[strcspn(modelo, "\n")] = '\0';
+                }
+                break;
+            }
+        }
+        fclose(f);
+    }
+    for (char *p = modelo; *p; p++) {
+        if (isspace((unsigned char) *p) || *p == '=') *p = '_';
+    }
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    if (cpus < 1) cpus = 1;
+    snprintf(buf, tam, "%s|%ld", modelo, cpus);
+}
+
+static inline const char *autotune_caminho(const char *padrao) {
+    const char *env = getenv("AUTOTUNE_CACHE");
+    return (env && env[0]) ? env : padrao;
+}
+
+// Preenche 'params' com a linha do fingerprint. Retorna 1 se achou, 0 se não.
+static inline int autotune_carregar(const char *caminho, const char *fp,
+                                    autotune_param_t *params, int n) {
+    FILE *f = fopen(caminho, "r");
+    if (!f) return 0;
+    char linha[AUTOTUNE_LINHA];
+    size_t tam_fp = strlen(fp);
+    int achou = 0;
+    while (!achou && fgets(linha, sizeof(linha), f)) {
+        if (strncmp(linha, fp, tam_fp) != 0 || linha[tam_fp] != ' ') continue;
+        achou = 1;
+        for (char *tok = strtok(linha + tam_fp, " \n"); tok; tok = strtok(NULL, " \n")) {
+            char *igual = strchr(tok, '=');
+            if (!igual) continue;
+            *igual = '\0';
+            for (int i = 0; i < n; i++) {
+                if (strcmp(params[i].nome, tok) == 0) params[i].valor = atoi(igual + 1);
+            }
+        }
+    }
+    fclose(f);
+    return achou;
+}
+
+// Regrava o arquivo trocando (ou acrescentando) só a linha deste fingerprint
+static inline int autotune_salvar(const char *caminho, const char *fp,
+                                  const autotune_param_t *params, int n) {
+    char tmp[512];
+    snprintf(tmp, sizeof(tmp), "%s.tmp", caminho);
+    FILE *out = fopen(tmp, "w");
+    if (!out) {
+        perror("autotune cache");
+        return -1;
+    }
+    FILE *in = fopen(caminho, "r");
+    if (in) {
+        char linha[AUTOTUNE_LINHA];
+        size_t tam_fp = strlen(fp);
+        while (fgets(linha, sizeof(linha), in)) {
+            if (strncmp(linha, fp, tam_fp) == 0 && linha[tam_fp] == ' ') continue;
+            fputs(linha, out);
+        }
+        fclose(in);
+    }
+    fprintf(out, "%s", fp);
+    for (int i = 0; i < n; i++) fprintf(out, " %s=%d", params[i].nome, params[i].valor);
+    fprintf(out, "\n");
+    fclose(out);
+    if (rename(tmp, caminho) != 0) {
+        perror("autotune rename");
+        return -1;
+    }
+    return 0;
+}
+
+#endif
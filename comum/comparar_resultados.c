@@ -0,0 +1,379 @@
+// gcc -std=c11 -Wall -Wextra -pedantic -O2 comparar_resultados.c -o comparar -lm
+// ./comparar base.txt novo.txt [--alpha 0.05] [--limiar 5]
+//
+// Compara dois conjuntos de resultados (linhas CSV_DATA de q1 ou q2).
+// Agrupa as repetições por configuração (tamanho, n_threads, seq/par, máquina
+// e parâmetros do kernel),
+// aplica Mann-Whitney bilateral nos tempos e estima a razão novo/base com
+// intervalo de confiança de Hodges-Lehmann (mesma estatística do teste).
+// Códigos de saída:
+//   0  nenhuma regressão, e toda configuração comparada teve amostras suficientes
+//   1  alguma configuração regrediu de forma significativa mais que --limiar %
+//   2  erro de uso/leitura
+//   3  inconclusivo: nenhuma configuração em comum entre os arquivos, ou
+//      alguma sem amostras suficientes para o teste/IC (rode com REPETICOES maior)
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#define MAX_AMOSTRAS 256 // por grupo; o IC de Hodges-Lehmann guarda m*n diferenças
+#define MAX_EXATO 30 // até este tamanho por grupo usa a distribuição exata de U
+
+// Uma configuração e suas repetições. Amostras de máquinas ou de variantes
+// do kernel diferentes nunca se misturam: 'config' junta computador, n_cpus
+// e os parâmetros de autotune da linha.
+typedef struct {
+    char tipo[16]; // "vetor" ou "matriz"
+    int tam;
+    int n_threads;
+    int paralelo;
+    char config[160];
+    int n;
+    int descartadas; // além de MAX_AMOSTRAS
+    double tempos[MAX_AMOSTRAS];
+} grupo_t;
+
+typedef struct {
+    grupo_t *grupos;
+    int n;
+    int cap;
+} conjunto_t;
+
+// Lê o valor de "chave: valor;" numa linha CSV_DATA
+static int campo(const char *linha, const char *chave, char *valor, size_t tam) {
+    char padrao[64];
+    snprintf(padrao, sizeof(padrao), " %s:", chave);
+    const char *p = strstr(linha, padrao);
+    if (!p) {
+        snprintf(padrao, sizeof(padrao), ";%s:", chave);
+        p = strstr(linha, padrao);
+        if (!p) return 0;
+    }
+    p += strlen(padrao);
+    while (*p == ' ') p++;
+    size_t n = strcspn(p, ";\n");
+    if (n >= tam) n = tam - 1;
+    memcpy(valor, p, n);
+    valor[n] = '\0';
+    return 1;
+}
+
+// Parâmetros de kernel por programa, com o valor que vale quando a coluna
+// não existe (resultados anteriores ao autotune rodavam o kernel original)
+typedef struct {
+    const char *chave;
+    const char *padrao;
+} coluna_config_t;
+
+static const coluna_config_t config_vetor[] = {
+    {"unroll", "1"}, {"corte_serial", "0"},
+};
+static const coluna_config_t config_matriz[] = {
+    {"bloco", "0"}, {"micro", "1"}, {"chunk", "0"},
+};
+
+// "computador/n_cpus unroll=1 corte_serial=0" (ou bloco/micro/chunk)
+static void montar_config(const char *linha, const char *tipo, char *buf, size_t tam) {
+    char comp[64] = "?", cpus[16] = "?", v[32];
+    campo(linha, "computador", comp, sizeof(comp));
+    campo(linha, "n_cpus", cpus, sizeof(cpus));
+    int usados = snprintf(buf, tam, "%s/%s", comp, cpus);
+
+    int matriz = strcmp(tipo, "matriz") == 0;
+    const coluna_config_t *cols = matriz ? config_matriz : config_vetor;
+    int n = matriz ? 3 : 2;
+    for (int i = 0; i < n && usados >= 0 && (size_t) usados < tam; i++) {
+        const char *valor = campo(linha, cols[i].chave, v, sizeof(v)) ? v : cols[i].padrao;
+        usados += snprintf(buf + usados, tam - (size_t) usados, " %s=%s", cols[i].chave, valor);
+    }
+}
+
+static grupo_t *buscar_grupo(conjunto_t *c, const char *tipo, int tam, int n_threads, int paralelo,
+                             const char *config, int criar) {
+    for (int i = 0; i < c->n; i++) {
+        grupo_t *g = &c->grupos[i];
+        if (strcmp(g->tipo, tipo) == 0 && g->tam == tam && g->n_threads == n_threads &&
+            g->paralelo == paralelo && strcmp(g->config, config) == 0)
+            return g;
+    }
+    if (!criar) return NULL;
+    if (c->n == c->cap) {
+        int cap = c->cap ? c->cap * 2 : 64;
+        grupo_t *novo = realloc(c->grupos, (size_t) cap * sizeof(grupo_t));
+        if (!novo) return NULL;
+        c->grupos = novo;
+        c->cap = cap;
+    }
+    grupo_t *g = &c->grupos[c->n++];
+    memset(g, 0, sizeof(*g));
+    snprintf(g->tipo, sizeof(g->tipo), "%s", tipo);
+    g->tam = tam;
+    g->n_threads = n_threads;
+    g->paralelo = paralelo;
+    snprintf(g->config, sizeof(g->config), "%s", config);
+    return g;
+}
+
+static int carregar(const char *caminho, conjunto_t *c) {
+    FILE *f = fopen(caminho, "r");
+    if (!f) {
+        perror(caminho);
+        return -1;
+    }
+    char linha[1024], v[64];
+    while (fgets(linha, sizeof(linha), f)) {
+        if (!strstr(linha, "CSV_DATA;")) continue;
+        const char *tipo = "vetor";
+        int tam;
+        if (campo(linha, "tam_vetor", v, sizeof(v))) tam = atoi(v);
+        else if (campo(linha, "tam_matriz", v, sizeof(v))) { tam = atoi(v); tipo = "matriz"; }
+        else continue;
+        if (!campo(linha, "n_threads", v, sizeof(v))) continue;
+        int n_threads = atoi(v);
+        double tp = campo(linha, "tp", v, sizeof(v)) ? atof(v) : 0.0;
+        double ts = campo(linha, "ts", v, sizeof(v)) ? atof(v) : 0.0;
+        int paralelo = tp > 0.0;
+        double t = paralelo ? tp : ts;
+        if (t <= 0.0) continue;
+
+        char config[160];
+        montar_config(linha, tipo, config, sizeof(config));
+        grupo_t *g = buscar_grupo(c, tipo, tam, n_threads, paralelo, config, 1);
+        if (!g) {
+            fclose(f);
+            return -1;
+        }
+        if (g->n < MAX_AMOSTRAS) g->tempos[g->n++] = t;
+        else g->descartadas++;
+    }
+    fclose(f);
+    for (int i = 0; i < c->n; i++) {
+        grupo_t *g = &c->grupos[i];
+        if (g->descartadas > 0)
+            fprintf(stderr, "%s: %s %d thr %d %s [%s]: %d amostra(s) alem de %d ignorada(s)\n",
+                    caminho, g->tipo, g->tam, g->n_threads, g->paralelo ? "par" : "seq",
+                    g->config, g->descartadas, MAX_AMOSTRAS);
+    }
+    return 0;
+}
+
+static int cmp_double(const void *a, const void *b) {
+    double x = *(const double *) a, y = *(const double *) b;
+    return (x > y) - (x < y);
+}
+
+static double mediana(double *v, int n) {
+    qsort(v, (size_t) n, sizeof(double), cmp_double);
+    return n % 2 ? v[n / 2] : 0.5 * (v[n / 2 - 1] + v[n / 2]);
+}
+
+// Distribuição exata de U (sem empates): cdf[u] = P(U <= u), u em [0, m*n]
+static double *cdf_exata_u(int m, int n) {
+    int maxu = m * n;
+    // cont[i][j][u] = arranjos de i amostras de A e j de B com U = u, em planos rolantes
+    double *ant = calloc((size_t) (n + 1) * (maxu + 1), sizeof(double));
+    double *atual = calloc((size_t) (n + 1) * (maxu + 1), sizeof(double));
+    double *cdf = malloc((size_t) (maxu + 1) * sizeof(double));
+    if (!ant || !atual || !cdf) {
+        free(ant); free(atual); free(cdf);
+        return NULL;
+    }
+#define C(p, j, u) p[(size_t) (j) * (maxu + 1) + (u)]
+    for (int j = 0; j <= n; j++) C(ant, j, 0) = 1.0; // i = 0
+    for (int i = 1; i <= m; i++) {
+        memset(atual, 0, (size_t) (n + 1) * (maxu + 1) * sizeof(double));
+        C(atual, 0, 0) = 1.0;
+        for (int j = 1; j <= n; j++) {
+            for (int u = 0; u <= i * j; u++) {
+                // o maior elemento é de A (supera os j de B) ou de B
+                double v = C(atual, j - 1, u);
+                if (u >= j) v += C(ant, j, u - j);
+                C(atual, j, u) = v;
+            }
+        }
+        double *tmp = ant; ant = atual; atual = tmp;
+    }
+    double total = 0.0;
+    for (int u = 0; u <= maxu; u++) total += C(ant, n, u);
+    double acum = 0.0;
+    for (int u = 0; u <= maxu; u++) {
+        acum += C(ant, n, u);
+        cdf[u] = acum / total;
+    }
+#undef C
+    free(ant); free(atual);
+    return cdf;
+}
+
+static double normal_cdf(double z) {
+    return 0.5 * erfc(-z / sqrt(2.0));
+}
+
+// z tal que P(Z > z) = p, por bisseção (p em (0, 0.5])
+static double z_critico(double p) {
+    double lo = 0.0, hi = 10.0;
+    for (int i = 0; i < 100; i++) {
+        double meio = 0.5 * (lo + hi);
+        if (1.0 - normal_cdf(meio) > p) lo = meio;
+        else hi = meio;
+    }
+    return 0.5 * (lo + hi);
+}
+
+typedef struct {
+    double p;          // valor-p bilateral
+    double razao;      // estimativa de Hodges-Lehmann de novo/base
+    double ic_inf, ic_sup;
+    int ic_valido;     // 0 se há amostras de menos para o nível pedido
+} comparacao_t;
+
+static void comparar(const grupo_t *a, const grupo_t *b, double alpha, comparacao_t *r) {
+    int m = a->n, n = b->n;
+
+    // U de A: pares (a, b) com a > b, empates contam 1/2; também detecta empates
+    double u = 0.0;
+    int empates = 0;
+    for (int i = 0; i < m; i++) {
+        for (int j = 0; j < n; j++) {
+            if (a->tempos[i] > b->tempos[j]) u += 1.0;
+            else if (a->tempos[i] == b->tempos[j]) { u += 0.5; empates = 1; }
+        }
+    }
+
+    // Diferenças log(novo) - log(base) ordenadas: mediana e IC de Hodges-Lehmann
+    int mn = m * n;
+    double *d = malloc((size_t) mn * sizeof(double));
+    if (!d) {
+        r->p = 1.0; r->razao = r->ic_inf = r->ic_sup = 1.0; r->ic_valido = 0;
+        return;
+    }
+    for (int i = 0; i < m; i++)
+        for (int j = 0; j < n; j++)
+            d[i * n + j] = log(b->tempos[j]) - log(a->tempos[i]);
+    double est = mediana(d, mn); // também ordena d
+
+    // k = maior c com P(U <= c) <= alpha/2; o IC é [d_(k+1), d_(mn-k)]
+    int k = -1;
+    double *cdf = (!empates && m <= MAX_EXATO && n <= MAX_EXATO) ? cdf_exata_u(m, n) : NULL;
+    if (cdf) {
+        // sem empates U é inteiro; por simetria P(U >= u) = P(U <= mn - u)
+        int ui = (int) u;
+        double cauda = ui <= mn - ui ? cdf[ui] : cdf[mn - ui];
+        r->p = fmin(1.0, 2.0 * cauda);
+        while (k + 1 <= mn && cdf[k + 1] <= alpha / 2.0) k++;
+        free(cdf);
+    } else {
+        // Aproximação normal com correção de empates e de continuidade
+        int N = m + n;
+        double *todos = malloc((size_t) N * sizeof(double));
+        double soma_t = 0.0;
+        if (todos) {
+            memcpy(todos, a->tempos, (size_t) m * sizeof(double));
+            memcpy(todos + m, b->tempos, (size_t) n * sizeof(double));
+            qsort(todos, (size_t) N, sizeof(double), cmp_double);
+            for (int i = 0; i < N; ) {
+                int j = i;
+                while (j < N && todos[j] == todos[i]) j++;
+                double t = j - i;
+                soma_t += t * t * t - t;
+                i = j;
+            }
+            free(todos);
+        }
+        double media = mn / 2.0;
+        double var = m * n / 12.0 * ((N + 1) - soma_t / ((double) N * (N - 1)));
+        if (var <= 0.0) {
+            r->p = 1.0;
+        } else {
+            double z = (fabs(u - media) - 0.5) / sqrt(var);
+            if (z < 0.0) z = 0.0;
+            r->p = fmin(1.0, 2.0 * (1.0 - normal_cdf(z)));
+        }
+        k = (int) floor(media - z_critico(alpha / 2.0) * sqrt(m * n * (N + 1) / 12.0)) - 1;
+    }
+
+    r->razao = exp(est);
+    r->ic_valido = k >= 0 && mn - 1 - k > k;
+    if (r->ic_valido) {
+        r->ic_inf = exp(d[k]);
+        r->ic_sup = exp(d[mn - 1 - k]);
+    } else {
+        r->ic_inf = exp(d[0]);
+        r->ic_sup = exp(d[mn - 1]);
+    }
+    free(d);
+}
+
+static const char *nome_modo(const grupo_t *g) {
+    return g->paralelo ? "par" : "seq";
+}
+
+int main(int argc, char *argv[]) {
+    const char *arq_base = NULL, *arq_novo = NULL;
+    double alpha = 0.05, limiar = 5.0;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--alpha") == 0 && i + 1 < argc) alpha = atof(argv[++i]);
+        else if (strcmp(argv[i], "--limiar") == 0 && i + 1 < argc) limiar = atof(argv[++i]);
+        else if (!arq_base) arq_base = argv[i];
+        else if (!arq_novo) arq_novo = argv[i];
+        else arq_base = NULL; // argumento sobrando: cai no uso
+    }
+    if (!arq_base || !arq_novo || alpha <= 0.0 || alpha >= 1.0 || limiar < 0.0) {
+        fprintf(stderr, "Uso: %s <base.txt> <novo.txt> [--alpha 0.05] [--limiar 5]\n"
+                        "Saida: 0 ok; 1 regressao; 2 erro de uso/leitura; "
+                        "3 inconclusivo (nada comparado ou amostras insuficientes)\n", argv[0]);
+        return 2;
+    }
+
+    conjunto_t base = {0}, novo = {0};
+    if (carregar(arq_base, &base) != 0 || carregar(arq_novo, &novo) != 0) return 2;
+
+    printf("%-7s %8s %4s %4s %5s %5s %12s %12s %8s %19s %8s  %-22s  %s\n",
+           "tipo", "tam", "thr", "modo", "n_b", "n_n", "med_base", "med_novo",
+           "razao", "IC", "p", "veredito", "config");
+
+    int regressoes = 0, comparadas = 0, insuficientes = 0;
+    for (int i = 0; i < base.n; i++) {
+        grupo_t *a = &base.grupos[i];
+        grupo_t *b = buscar_grupo(&novo, a->tipo, a->tam, a->n_threads, a->paralelo, a->config, 0);
+        if (!b) continue;
+        comparadas++;
+
+        comparacao_t r;
+        comparar(a, b, alpha, &r);
+
+        double copia_a[MAX_AMOSTRAS], copia_b[MAX_AMOSTRAS];
+        memcpy(copia_a, a->tempos, (size_t) a->n * sizeof(double));
+        memcpy(copia_b, b->tempos, (size_t) b->n * sizeof(double));
+        double med_a = mediana(copia_a, a->n), med_b = mediana(copia_b, b->n);
+
+        // Razão > 1 = novo mais lento. Só conta se significativo e acima do limiar.
+        const char *veredito = "=";
+        if (!r.ic_valido) { veredito = "amostras insuficientes"; insuficientes++; }
+        else if (r.p < alpha && r.razao > 1.0 + limiar / 100.0) { veredito = "REGRESSAO"; regressoes++; }
+        else if (r.p < alpha && r.razao < 1.0 - limiar / 100.0) veredito = "melhoria";
+
+        char ic[32];
+        snprintf(ic, sizeof(ic), "[%.3f, %.3f]", r.ic_inf, r.ic_sup);
+        printf("%-7s %8d %4d %4s %5d %5d %12.6f %12.6f %8.3f %19s %8.4f  %-22s  %s\n",
+               a->tipo, a->tam, a->n_threads, nome_modo(a), a->n, b->n,
+               med_a, med_b, r.razao, ic, r.p, veredito, a->config);
+    }
+
+    printf("\n%d configuracao(oes) comparada(s), %d regressao(oes) acima de %.1f%% (alpha %.3f, IC %.0f%%)\n",
+           comparadas, regressoes, limiar, alpha, 100.0 * (1.0 - alpha));
+    free(base.grupos); free(novo.grupos);
+    if (regressoes > 0) return 1;
+    if (comparadas == 0) {
+        fprintf(stderr, "Nenhuma configuracao em comum entre %s e %s.\n", arq_base, arq_novo);
+        return 3;
+    }
+    if (insuficientes > 0) {
+        fprintf(stderr, "%d configuracao(oes) sem amostras suficientes; resultado inconclusivo.\n", insuficientes);
+        return 3;
+    }
+    return 0;
+}
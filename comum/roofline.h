@@ -0,0 +1,240 @@
+// Sonda de roofline compartilhada por q1 e q2.
+// Mede a banda de memória (triad estilo STREAM) e o pico de FLOP/s
+// (multiplica-soma) para um número de threads, guarda o resultado num
+// cache por host e posiciona uma execução de kernel no roofline.
+//
+// Uso: #include "../comum/roofline.h" num programa compilado com -pthread.
+// O pico de FLOP/s é medido com as mesmas flags do programa que inclui este
+// arquivo, então o teto é o que aquele binário consegue atingir.
+#ifndef ROOFLINE_H
+#define ROOFLINE_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <time.h>
+#include <unistd.h>
+
+#define ROOFLINE_MAX_PONTOS 64
+#define ROOFLINE_TRIAD_ELEMS (4 * 1024 * 1024) // 3 vetores de 32 MB: bem maior que a LLC
+#define ROOFLINE_FMA_ACC 32                    // acumuladores independentes por thread
+#define ROOFLINE_FMA_ITER 4000000L
+#define ROOFLINE_REPETICOES 5
+
+// Um ponto medido: picos para uma quantidade de threads
+typedef struct {
+    int n_threads;
+    double gbs;    // banda triad em GB/s
+    double gflops; // pico de multiplica-soma em GFLOP/s
+} roofline_ponto_t;
+
+typedef struct {
+    char host[64];
+    long n_cpus;
+    int n_pontos;
+    roofline_ponto_t pontos[ROOFLINE_MAX_PONTOS];
+} roofline_t;
+
+// Argumentos das threads da sonda (triad e FMA usam a mesma estrutura)
+typedef struct {
+    double *a;
+    const double *b;
+    const double *c;
+    long inicio;
+    long fim;
+    double resultado;
+} roofline_arg_t;
+
+static inline double roofline_agora(void) {
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec + t.tv_nsec / 1e9;
+}
+
+// a[i] = b[i] + s * c[i]  -> 2 leituras + 1 escrita = 24 bytes, 2 FLOPs
+static inline void *roofline_thread_triad(void *arg) {
+    roofline_arg_t *ra = (roofline_arg_t *) arg;
+    const double s = 3.0;
+    for (long i = ra->inicio; i < ra->fim; i++) {
+        ra->a[i] = ra->b[i] + s * ra->c[i];
+    }
+    return NULL;
+}
+
+// Cadeias independentes de acc = acc * m + d, para o compilador poder
+// vetorizar e esconder a latência da unidade de ponto flutuante.
+static inline void *roofline_thread_fma(void *arg) {
+    roofline_arg_t *ra = (roofline_arg_t *) arg;
+    double acc[ROOFLINE_FMA_ACC];
+    const double m = 0.999999, d = 1e-6;
+    for (int j = 0; j < ROOFLINE_FMA_ACC; j++) acc[j] = (double) j;
+    for (long it = 0; it < ROOFLINE_FMA_ITER; it++) {
+        for (int j = 0; j < ROOFLINE_FMA_ACC; j++) {
+            acc[j] = acc[j] * m + d;
+        }
+    }
+    double soma = 0.0;
+    for (int j = 0; j < ROOFLINE_FMA_ACC; j++) soma += acc[j];
+    ra->resultado = soma; // impede que o laço seja eliminado
+    return NULL;
+}
+
+// Executa 'rotina' em n_threads threads, dividindo [0, total) em blocos
+// contíguos (mesma divisão base/resto dos kernels). Retorna o tempo em s.
+static inline double roofline_executar(void *(*rotina)(void *), int n_threads,
+                                       double *a, const double *b, const double *c,
+                                       long total) {
+    pthread_t *threads = malloc((size_t) n_threads * sizeof(pthread_t));
+    roofline_arg_t *args = malloc((size_t) n_threads * sizeof(roofline_arg_t));
+    if (!threads || !args) {
+        free(threads); free(args);
+        return -1.0;
+    }
+
+    long base = total / n_threads, resto = total % n_threads, offset = 0;
+    double t0 = roofline_agora();
+    int criadas = 0;
+    for (int t = 0; t < n_threads; t++) {
+        long fim = offset + base + (t < resto ? 1 : 0);
+        args[t] = (roofline_arg_t) { a, b, c, offset, fim, 0.0 };
+        if (pthread_create(&threads[t], NULL, rotina, &args[t]) != 0) break;
+        criadas++;
+        offset = fim;
+    }
+    for (int t = 0; t < criadas; t++) pthread_join(threads[t], NULL);
+    double dt = roofline_agora() - t0;
+
+    free(threads); free(args);
+    return criadas == n_threads ? dt : -1.0;
+}
+
+// Mede banda triad e pico de FLOP/s para n_threads (melhor de N repetições)
+static inline int roofline_medir(int n_threads, roofline_ponto_t *p) {
+    long n = ROOFLINE_TRIAD_ELEMS;
+    double *a = malloc((size_t) n * sizeof(double));
+    double *b = malloc((size_t) n * sizeof(double));
+    double *c = malloc((size_t) n * sizeof(double));
+    if (!a || !b || !c) {
+        perror("malloc roofline");
+        free(a); free(b); free(c);
+        return -1;
+    }
+    for (long i = 0; i < n; i++) {
+        a[i] = 0.0; b[i] = 1.0; c[i] = 2.0;
+    }
+
+    double melhor_triad = 1e30, melhor_fma = 1e30;
+    for (int r = 0; r < ROOFLINE_REPETICOES; r++) {
+        double dt = roofline_executar(roofline_thread_triad, n_threads, a, b, c, n);
+        if (dt > 0 && dt < melhor_triad) melhor_triad = dt;
+        // no FMA cada thread faz a mesma quantidade de trabalho: 'total' = n_threads
+        dt = roofline_executar(roofline_thread_fma, n_threads, NULL, NULL, NULL, n_threads);
+        if (dt > 0 && dt < melhor_fma) melhor_fma = dt;
+    }
+    free(a); free(b); free(c);
+    if (melhor_triad >= 1e30 || melhor_fma >= 1e30) return -1;
+
+    p->n_threads = n_threads;
+    p->gbs = 24.0 * n / melhor_triad / 1e9;
+    p->gflops = 2.0 * ROOFLINE_FMA_ACC * ROOFLINE_FMA_ITER * n_threads / melhor_fma / 1e9;
+    return 0;
+}
+
+// --- CACHE POR HOST ---
+// Formato (texto):
+//   host <nome> cpus <n>
+//   <n_threads> <gbs> <gflops>
+// O caminho vem de ROOFLINE_CACHE ou é roofline_<host>.cache no diretório atual.
+
+static inline void roofline_caminho_cache(const roofline_t *r, char *buf, size_t tam) {
+    const char *env = getenv("ROOFLINE_CACHE");
+    if (env && env[0]) snprintf(buf, tam, "%s", env);
+    else snprintf(buf, tam, "roofline_%s.cache", r->host);
+}
+
+static inline void roofline_iniciar(roofline_t *r) {
+    memset(r, 0, sizeof(*r));
+    if (gethostname(r->host, sizeof(r->host) - 1) != 0) strcpy(r->host, "desconhecido");
+    r->n_cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    if (r->n_cpus < 1) r->n_cpus = 1;
+}
+
+// Carrega o cache; pontos de outro host ou com outra contagem de CPUs são ignorados
+static inline void roofline_carregar(roofline_t *r) {
+    char caminho[512], host[64];
+    long cpus = 0;
+    roofline_caminho_cache(r, caminho, sizeof(caminho));
+    FILE *f = fopen(caminho, "r");
+    if (!f) return;
+    if (fscanf(f, "host %63s cpus %ld", host, &cpus) == 2 &&
+        strcmp(host, r->host) == 0 && cpus == r->n_cpus) {
+        roofline_ponto_t p;
+        while (r->n_pontos < ROOFLINE_MAX_PONTOS &&
+               fscanf(f, "%d %lf %lf", &p.n_threads, &p.gbs, &p.gflops) == 3) {
+            r->pontos[r->n_pontos++] = p;
+        }
+    }
+    fclose(f);
+}
+
+static inline void roofline_salvar(const roofline_t *r) {
+    char caminho[512];
+    roofline_caminho_cache(r, caminho, sizeof(caminho));
+    FILE *f = fopen(caminho, "w");
+    if (!f) {
+        perror("roofline cache");
+        return;
+    }
+    fprintf(f, "host %s cpus %ld\n", r->host, r->n_cpus);
+    for (int i = 0; i < r->n_pontos; i++) {
+        fprintf(f, "%d %.3f %.3f\n", r->pontos[i].n_threads, r->pontos[i].gbs, r->pontos[i].gflops);
+    }
+    fclose(f);
+}
+
+// Devolve o ponto para n_threads, medindo (e gravando no cache) se ainda não existir
+static inline const roofline_ponto_t *roofline_obter(roofline_t *r, int n_threads) {
+    for (int i = 0; i < r->n_pontos; i++) {
+        if (r->pontos[i].n_threads == n_threads) return &r->pontos[i];
+    }
+    if (r->n_pontos >= ROOFLINE_MAX_PONTOS) return NULL;
+
+    fprintf(stderr, "[ROOFLINE] Medindo picos com %d thread(s) em %s...\n", n_threads, r->host);
+    roofline_ponto_t p;
+    if (roofline_medir(n_threads, &p) != 0) return NULL;
+    r->pontos[r->n_pontos++] = p;
+    roofline_salvar(r);
+    return &r->pontos[r->n_pontos - 1];
+}
+
+// Posiciona uma execução no roofline. 'flops' e 'bytes' são o trabalho e o
+// tráfego de memória do kernel; 'tempo' em segundos.
+static inline void roofline_reportar(roofline_t *r, int n_threads,
+                                     double flops, double bytes, double tempo) {
+    const roofline_ponto_t *p = roofline_obter(r, n_threads);
+    if (!p || tempo <= 0.0) {
+        fprintf(stderr, "[ROOFLINE] Sem medição disponível.\n");
+        return;
+    }
+    double ai = flops / bytes;               // intensidade aritmética (FLOP/byte)
+    double gbs = bytes / tempo / 1e9;
+    double gflops = flops / tempo / 1e9;
+    double teto_mem = ai * p->gbs;           // GFLOP/s permitidos pela banda
+    double teto = teto_mem < p->gflops ? teto_mem : p->gflops;
+
+    printf("ROOFLINE;");
+    printf(" n_threads: %d;", n_threads);
+    printf(" ai: %.4f;", ai);
+    printf(" gbs: %.3f;", gbs);
+    printf(" gflops: %.3f;", gflops);
+    printf(" pico_gbs: %.3f;", p->gbs);
+    printf(" pico_gflops: %.3f;", p->gflops);
+    printf(" pct_banda: %.1f;", 100.0 * gbs / p->gbs);
+    printf(" pct_gflops: %.1f;", 100.0 * gflops / p->gflops);
+    printf(" pct_teto: %.1f;", 100.0 * gflops / teto);
+    printf(" limite: %s;", teto_mem < p->gflops ? "memoria" : "computacao");
+    printf("\n");
+}
+
+#endif
@@ -0,0 +1,39 @@
+// gcc -std=c11 -Wall -Wextra -pedantic -O2 -pthread sonda_roofline.c -o sonda
+// ./sonda 32
+// Mede (ou lê do cache) banda triad e pico de FLOP/s de 1 até <max_threads>
+// threads em potências de 2, mais o número de CPUs do host.
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdlib.h>
+#include "roofline.h"
+
+int main(int argc, char *argv[]) {
+    roofline_t roof;
+    roofline_iniciar(&roof);
+    roofline_carregar(&roof);
+
+    int max_threads = (int) roof.n_cpus;
+    if (argc >= 2) max_threads = atoi(argv[1]);
+    if (max_threads < 1) {
+        fprintf(stderr, "Uso: %s [max_threads]\n", argv[0]);
+        return 1;
+    }
+
+    printf("host: %s; n_cpus: %ld\n", roof.host, roof.n_cpus);
+    printf("%10s %12s %12s %14s\n", "n_threads", "triad GB/s", "GFLOP/s", "AI de cotovelo");
+    for (int t = 1; t <= max_threads; ) {
+        const roofline_ponto_t *p = roofline_obter(&roof, t);
+        if (!p) {
+            fprintf(stderr, "Falha ao medir %d thread(s)\n", t);
+            return 1;
+        }
+        // AI a partir da qual o kernel deixa de ser limitado pela memória
+        printf("%10d %12.3f %12.3f %14.3f\n", p->n_threads, p->gbs, p->gflops, p->gflops / p->gbs);
+
+        // próxima potência de 2, passando pelo número de CPUs se ele estiver no meio
+        int prox = t * 2;
+        if (t < roof.n_cpus && prox > roof.n_cpus) prox = (int) roof.n_cpus;
+        t = prox;
+    }
+    return 0;
+}
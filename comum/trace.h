@@ -0,0 +1,117 @@
+// Rastreamento de linha do tempo por thread, exportado como JSON do
+// Chrome trace / Perfetto (abrir em chrome://tracing ou ui.perfetto.dev).
+//
+// Cada thread escreve só no seu próprio buffer pré-alocado (índice fixo),
+// então o caminho quente não usa locks nem malloc. Quando o buffer enche,
+// os eventos seguintes são descartados e contados.
+// Convenção dos programas: buffer 0 = thread principal, 1..T = workers.
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define TRACE_CAP_PADRAO 8192
+
+// Evento completo ("ph":"X"): nome, início, duração e um argumento inteiro
+typedef struct {
+    const char *nome; // precisa ser literal ou viver até o fim do trace
+    double ts_us;
+    double dur_us;
+    long arg;
+} trace_evento_t;
+
+// Ocupa exatamente 64 bytes e o vetor vem de aligned_alloc(64, ...), então
+// cada buffer fica numa linha de cache própria e threads vizinhas não a dividem
+typedef struct {
+    trace_evento_t *ev;
+    int n;
+    int cap;
+    long descartados;
+    char pad[64 - sizeof(trace_evento_t *) - 2 * sizeof(int) - sizeof(long)];
+} trace_buffer_t;
+
+_Static_assert(sizeof(trace_buffer_t) == 64, "trace_buffer_t deve ocupar uma linha de cache");
+
+typedef struct {
+    trace_buffer_t *buffers;
+    int n_buffers;
+    double t0_us;
+} trace_t;
+
+static inline double trace_relogio_us(void) {
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec * 1e6 + t.tv_nsec / 1e3;
+}
+
+// Microssegundos desde trace_iniciar (NULL = rastreamento desligado)
+static inline double trace_agora(const trace_t *t) {
+    return t ? trace_relogio_us() - t->t0_us : 0.0;
+}
+
+static inline int trace_iniciar(trace_t *t, int n_buffers, int cap) {
+    t->n_buffers = n_buffers;
+    // Tamanho múltiplo de 64, como aligned_alloc exige
+    t->buffers = aligned_alloc(64, (size_t) n_buffers * sizeof(trace_buffer_t));
+    if (!t->buffers) return -1;
+    memset(t->buffers, 0, (size_t) n_buffers * sizeof(trace_buffer_t));
+    for (int i = 0; i < n_buffers; i++) {
+        t->buffers[i].cap = cap;
+        t->buffers[i].ev = malloc((size_t) cap * sizeof(trace_evento_t));
+        if (!t->buffers[i].ev) return -1;
+    }
+    t->t0_us = trace_relogio_us();
+    return 0;
+}
+
+static inline void trace_liberar(trace_t *t) {
+    if (!t->buffers) return;
+    for (int i = 0; i < t->n_buffers; i++) free(t->buffers[i].ev);
+    free(t->buffers);
+    t->buffers = NULL;
+}
+
+// Registra [inicio, fim) no buffer 'buf'. Só a thread dona do buffer chama isto.
+static inline void trace_registrar(trace_t *t, int buf, const char *nome,
+                                   double inicio, double fim, long arg) {
+    if (!t) return;
+    trace_buffer_t *b = &t->buffers[buf];
+    if (b->n >= b->cap) {
+        b->descartados++;
+        return;
+    }
+    b->ev[b->n++] = (trace_evento_t) { nome, inicio, fim - inicio, arg };
+}
+
+// Grava o JSON. Chamar depois do pthread_join de todas as threads.
+static inline int trace_salvar_json(const trace_t *t, const char *caminho, const char *processo) {
+    FILE *f = fopen(caminho, "w");
+    if (!f) {
+        perror("trace");
+        return -1;
+    }
+    long descartados = 0;
+    fprintf(f, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+    fprintf(f, "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"tid\":0,\"args\":{\"name\":\"%s\"}}", processo);
+    for (int i = 0; i < t->n_buffers; i++) {
+        const trace_buffer_t *b = &t->buffers[i];
+        if (i == 0)
+            fprintf(f, ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":0,\"args\":{\"name\":\"main\"}}");
+        else
+            fprintf(f, ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"args\":{\"name\":\"worker %d\"}}", i, i - 1);
+        for (int k = 0; k < b->n; k++) {
+            fprintf(f, ",\n{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f,\"args\":{\"arg\":%ld}}",
+                    b->ev[k].nome, i, b->ev[k].ts_us, b->ev[k].dur_us, b->ev[k].arg);
+        }
+        descartados += b->descartados;
+    }
+    fprintf(f, "\n],\"otherData\":{\"descartados\":%ld}}\n", descartados);
+    fclose(f);
+    if (descartados > 0) fprintf(stderr, "[TRACE] %ld evento(s) descartados (buffer cheio)\n", descartados);
+    return 0;
+}
+
+#endif
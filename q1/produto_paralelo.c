@@ -1,5 +1,9 @@
 //  gcc -std=c11 -Wall -Wextra -pedantic -O2 -pthread produto_paralelo.c -o prod
 //./prodseq 10000 4
+//./prod 10000 4 --roofline   (posiciona a execução no roofline do host)
+//./prod 10000 4 --trace prod.json   (linha do tempo das threads, Chrome trace)
+//./prod 10000 0   (threads, unroll e corte serial vindos do cache de autotune)
+//./prod 10000 4 --tune   (refaz a busca de parâmetros para este host)
 #define _POSIX_C_SOURCE 200809L
 #include <stdio.h>
 #include <string.h>
@@ -8,6 +12,17 @@
 #include <time.h>
 #include <unistd.h>
 #include <errno.h>
+#include <limits.h>
+#include "../comum/roofline.h"
+#include "../comum/trace.h"
+#include "../comum/autotune.h"
+
+// Elementos por chunk registrado no trace
+#define CHUNK_ELEMS 65536
+
+#define AUTOTUNE_ARQUIVO "autotune_produto.cache"
+#define AUTOTUNE_TAM_SONDA (1 << 22)
+#define CORTE_SERIAL_SEMPRE INT_MAX // paralelo não vence em nenhum tamanho
 
 typedef struct {
     double *vetor1;
@@ -15,15 +30,52 @@ typedef struct {
     int start_index;
     int end_index;
     double partial_sum;
+    int unroll;       // acumuladores independentes: 1, 4 ou 8
+    trace_t *trace;   // NULL quando --trace não foi pedido
+    int trace_buf;    // buffer exclusivo desta thread
 } thread_arg_t;
 
+// Soma a[i]*b[i] em [ini, fim) a partir de 'soma' usando U acumuladores.
+// Chamada com U constante para o compilador especializar cada variante.
+static inline double produto_faixa_u(const double *a, const double *b,
+                                     int ini, int fim, double soma, const int U) {
+    int i = ini;
+    if (U > 1) {
+        double s[8] = {0};
+        s[0] = soma;
+        for (; i + U <= fim; i += U) {
+            for (int u = 0; u < U; u++) s[u] += a[i + u] * b[i + u];
+        }
+        soma = 0.0;
+        for (int u = 0; u < U; u++) soma += s[u];
+    }
+    for (; i < fim; i++) soma += a[i] * b[i];
+    return soma;
+}
+
+static double produto_faixa(const double *a, const double *b, int ini, int fim,
+                            double soma, int unroll) {
+    switch (unroll) {
+        case 8: return produto_faixa_u(a, b, ini, fim, soma, 8);
+        case 4: return produto_faixa_u(a, b, ini, fim, soma, 4);
+        default: return produto_faixa_u(a, b, ini, fim, soma, 1);
+    }
+}
+
 void *calcularProdutoEscalarParalelo(void *arg) {
     thread_arg_t *ta = (thread_arg_t *) arg;
+    double t_inicio = trace_agora(ta->trace);
     double soma_local = 0.0;
-    for (int i = ta->start_index; i < ta->end_index; i++) {
-        soma_local += ta->vetor1[i] * ta->vetor2[i];
+    // Percorre a faixa em chunks só para poder marcar cada um no trace;
+    // com unroll 1 a ordem da soma é a mesma do laço único.
+    for (int c = ta->start_index; c < ta->end_index; c += CHUNK_ELEMS) {
+        int fim = c + CHUNK_ELEMS < ta->end_index ? c + CHUNK_ELEMS : ta->end_index;
+        double t_chunk = trace_agora(ta->trace);
+        soma_local = produto_faixa(ta->vetor1, ta->vetor2, c, fim, soma_local, ta->unroll);
+        trace_registrar(ta->trace, ta->trace_buf, "chunk", t_chunk, trace_agora(ta->trace), c);
     }
     ta->partial_sum = soma_local;
+    trace_registrar(ta->trace, ta->trace_buf, "kernel", t_inicio, trace_agora(ta->trace), ta->end_index - ta->start_index);
     return NULL;
 }
 
@@ -40,6 +92,124 @@ static double timespec_diff_seconds(struct timespec a, struct timespec b) {
     return (b.tv_sec - a.tv_sec) + (b.tv_nsec - a.tv_nsec) / 1e9;
 }
 
+// Cria num_threads workers sobre [0, tam_vetor), espera todos e soma as
+// parciais. Retorna quantas threads foram de fato criadas.
+static int executar_paralelo(double *vetor1, double *vetor2, int tam_vetor,
+                             int num_threads, int unroll, trace_t *trace,
+                             pthread_t *threads, thread_arg_t *args, double *resultado) {
+    int base = tam_vetor / num_threads;
+    int resto = tam_vetor % num_threads;
+    int offset = 0;
+
+    for (int t = 0; t < num_threads; ++t) {
+        int end = offset + base + (t < resto ? 1 : 0);
+        args[t].vetor1 = vetor1;
+        args[t].vetor2 = vetor2;
+        args[t].start_index = offset;
+        args[t].end_index = end;
+        args[t].partial_sum = 0.0;
+        args[t].unroll = unroll;
+        args[t].trace = trace;
+        args[t].trace_buf = t + 1;
+        double t_create = trace_agora(trace);
+        int rc = pthread_create(&threads[t], NULL, calcularProdutoEscalarParalelo, &args[t]);
+        trace_registrar(trace, 0, "pthread_create", t_create, trace_agora(trace), t);
+        if (rc != 0) {
+            fprintf(stderr, "pthread_create failed: %s\n", strerror(rc));
+            // ajusta num_threads para aguardar só os já criados
+            num_threads = t;
+            break;
+        }
+        offset = end;
+    }
+
+    *resultado = 0.0;
+    for (int t = 0; t < num_threads; ++t) {
+        double t_join = trace_agora(trace);
+        int rc = pthread_join(threads[t], NULL);
+        trace_registrar(trace, 0, "pthread_join", t_join, trace_agora(trace), t);
+        if (rc != 0) {
+            fprintf(stderr, "pthread_join failed: %s\n", strerror(rc));
+        } else {
+            *resultado += args[t].partial_sum;
+        }
+    }
+    return num_threads;
+}
+
+// --- AUTOTUNE ---
+// Menor tempo de 'reps' execuções; num_threads == 0 = laço serial na thread principal
+static double medir_produto(double *v1, double *v2, int n, int num_threads, int unroll, int reps) {
+    pthread_t threads[256];
+    thread_arg_t args[256];
+    double melhor = 1e30, r;
+    for (int i = 0; i < reps; i++) {
+        double t0 = autotune_agora();
+        if (num_threads == 0) r = produto_faixa(v1, v2, 0, n, 0.0, unroll);
+        else executar_paralelo(v1, v2, n, num_threads, unroll, NULL, threads, args, &r);
+        double dt = autotune_agora() - t0;
+        if (dt < melhor) melhor = dt;
+    }
+    return melhor;
+}
+
+// Busca: unroll no kernel serial, depois threads e corte serial juntos, para
+// o cache nunca guardar um número de threads que o corte torna inalcançável.
+// Não há chunk como no q2: cada elemento custa o mesmo e o laço é limitado
+// por memória, então faixas contíguas iguais por thread já são a divisão
+// ótima e um chunk menor só somaria sincronização. Resultado em params.
+static int autotune_produto(autotune_param_t *params, long cpus) {
+    int n = AUTOTUNE_TAM_SONDA;
+    double *v1 = malloc((size_t) n * sizeof(double));
+    double *v2 = malloc((size_t) n * sizeof(double));
+    if (!v1 || !v2) {
+        perror("malloc autotune");
+        free(v1); free(v2);
+        return -1;
+    }
+    for (int i = 0; i < n; i++) {
+        v1[i] = (double) rand() / RAND_MAX;
+        v2[i] = (double) rand() / RAND_MAX;
+    }
+
+    // 1. variante do kernel (acumuladores independentes), medida sem threads
+    static const int unrolls[] = {1, 4, 8};
+    int melhor_u = 1;
+    double melhor = 1e30;
+    for (int i = 0; i < 3; i++) {
+        double dt = medir_produto(v1, v2, n, 0, unrolls[i], 5);
+        if (dt < 0.97 * melhor) { melhor = dt; melhor_u = unrolls[i]; } // só troca por ganho > 3%
+    }
+
+    // 2. threads (potências de 2 até 2x o número de CPUs, limite de 256) e,
+    // para cada uma, o corte: menor tamanho a partir do qual ela sempre vence
+    // o serial. Fica a mais rápida no tamanho da sonda; se nenhuma vence o
+    // resultado é "sempre serial" com 1 thread.
+    int melhor_t = 1, corte = CORTE_SERIAL_SEMPRE;
+    melhor = medir_produto(v1, v2, n, 0, melhor_u, 5);
+    for (int t = 2; t <= 2 * cpus && t <= 256; t *= 2) {
+        double dt = medir_produto(v1, v2, n, t, melhor_u, 5);
+        if (dt >= 0.97 * melhor) continue;
+        int corte_t = n;
+        for (int tam = n / 4; tam >= 1024; tam /= 4) {
+            int reps = (1 << 24) / tam;
+            if (reps < 5) reps = 5;
+            if (reps > 200) reps = 200;
+            if (medir_produto(v1, v2, tam, t, melhor_u, reps) >= medir_produto(v1, v2, tam, 0, melhor_u, reps)) break;
+            corte_t = tam;
+        }
+        melhor = dt;
+        melhor_t = t;
+        corte = corte_t;
+    }
+
+    free(v1); free(v2);
+    params[0].valor = melhor_t;
+    params[1].valor = melhor_u;
+    params[2].valor = corte;
+    return 0;
+}
+
 int main(int argc, char *argv[]) {
     int tam_vetor = 0, num_threads = 0;
     double *vetor1 = NULL, *vetor2 = NULL;
@@ -47,8 +217,8 @@ int main(int argc, char *argv[]) {
     if (cpus < 1) cpus = 1;
 
     if (argc < 3) {
-        fprintf(stderr, "Uso: %s <tamanho_vetor> <num_threads>\n", argv[0]);
-        fprintf(stderr, "Exemplo: %s 1000000 4\n", argv[0]);
+        fprintf(stderr, "Uso: %s <tamanho_vetor> <num_threads> [--roofline] [--trace arquivo.json] [--tune | --sem-tune]\n", argv[0]);
+        fprintf(stderr, "Exemplo: %s 1000000 4   (num_threads 0 = valor do autotune)\n", argv[0]);
         return 1;
     }
 
@@ -62,12 +232,60 @@ int main(int argc, char *argv[]) {
 
     endptr = NULL;
     long val_p = strtol(argv[2], &endptr, 10);
-    if (endptr == argv[2] || val_p <= 0) {
+    if (endptr == argv[2] || val_p < 0) {
         fprintf(stderr, "Número de threads inválido: %s\n", argv[2]);
         return 1;
     }
     num_threads = (int) val_p;
 
+    int usar_roofline = 0;
+    int forcar_tune = 0, sem_tune = 0;
+    const char *arquivo_trace = NULL;
+    for (int i = 3; i < argc; i++) {
+        if (strcmp(argv[i], "--roofline") == 0) usar_roofline = 1;
+        else if (strcmp(argv[i], "--trace") == 0 && i + 1 < argc) arquivo_trace = argv[++i];
+        else if (strcmp(argv[i], "--tune") == 0) forcar_tune = 1;
+        else if (strcmp(argv[i], "--sem-tune") == 0) sem_tune = 1;
+        else {
+            fprintf(stderr, "Opção desconhecida: %s\n", argv[i]);
+            return 1;
+        }
+    }
+
+    // Padrões = comportamento original (todas as CPUs, 1 acumulador, sempre paralelo).
+    // Sem linha no cache para este hardware, a busca roda e grava os vencedores.
+    autotune_param_t params[] = {
+        {"threads", (int) cpus},
+        {"unroll", 1},
+        {"corte_serial", 0},
+    };
+    // Só o modo automático (num_threads 0) usa o cache; com threads explícitas
+    // nem lê nem busca, a não ser com --tune, para a primeira execução de um
+    // run_tests.sh não pagar a busca nem deixar um .cache no diretório.
+    if (!sem_tune && (num_threads == 0 || forcar_tune)) {
+        char fp[300];
+        autotune_fingerprint(fp, sizeof(fp));
+        const char *caminho = autotune_caminho(AUTOTUNE_ARQUIVO);
+        if (forcar_tune || !autotune_carregar(caminho, fp, params, 3)) {
+            fprintf(stderr, "[AUTOTUNE] Buscando parâmetros para %s...\n", fp);
+            if (autotune_produto(params, cpus) == 0) {
+                autotune_salvar(caminho, fp, params, 3);
+                fprintf(stderr, "[AUTOTUNE] threads=%d unroll=%d corte_serial=%d\n",
+                        params[0].valor, params[1].valor, params[2].valor);
+            }
+        }
+    }
+    // num_threads 0: threads, unroll e corte do autotune (tamanhos abaixo do
+    // corte rodam sem threads). Com threads explícitas roda o kernel original,
+    // para o resultado e o tempo não dependerem do cache que estiver no disco.
+    int serial = 0, unroll = 1, corte_serial = 0;
+    if (num_threads == 0) {
+        num_threads = params[0].valor > 0 ? params[0].valor : 1;
+        unroll = params[1].valor;
+        corte_serial = params[2].valor;
+        serial = tam_vetor < corte_serial;
+    }
+
     if (num_threads > tam_vetor) {
         num_threads = tam_vetor;
         if (num_threads < 1) num_threads = 1;
@@ -102,36 +320,27 @@ int main(int argc, char *argv[]) {
         return 1;
     }
 
-    int base = tam_vetor / num_threads;
-    int resto = tam_vetor % num_threads;
-    int offset = 0;
-
-    clock_gettime(CLOCK_MONOTONIC, &t0);
-    for (int t = 0; t < num_threads; ++t) {
-        int end = offset + base + (t < resto ? 1 : 0);
-        args[t].vetor1 = vetor1;
-        args[t].vetor2 = vetor2;
-        args[t].start_index = offset;
-        args[t].end_index = end;
-        args[t].partial_sum = 0.0;
-        int rc = pthread_create(&threads[t], NULL, calcularProdutoEscalarParalelo, &args[t]);
-        if (rc != 0) {
-            fprintf(stderr, "pthread_create failed: %s\n", strerror(rc));
-            // ajusta num_threads para aguardar só os já criados
-            num_threads = t;
-            break;
+    // Buffer 0 = thread principal (create/join), 1..num_threads = workers
+    trace_t trace_dados = {0};
+    trace_t *trace = NULL;
+    if (arquivo_trace) {
+        if (trace_iniciar(&trace_dados, num_threads + 1, TRACE_CAP_PADRAO) != 0) {
+            perror("malloc trace");
+            trace_liberar(&trace_dados);
+            free(vetor1); free(vetor2); free(threads); free(args);
+            return 1;
         }
-        offset = end;
+        trace = &trace_dados;
     }
 
     double resultado_paralelo = 0.0;
-    for (int t = 0; t < num_threads; ++t) {
-        int rc = pthread_join(threads[t], NULL);
-        if (rc != 0) {
-            fprintf(stderr, "pthread_join failed: %s\n", strerror(rc));
-        } else {
-            resultado_paralelo += args[t].partial_sum;
-        }
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    if (serial) {
+        resultado_paralelo = produto_faixa(vetor1, vetor2, 0, tam_vetor, 0.0, unroll);
+        num_threads = 1;
+    } else {
+        num_threads = executar_paralelo(vetor1, vetor2, tam_vetor, num_threads, unroll,
+                                        trace, threads, args, &resultado_paralelo);
     }
     clock_gettime(CLOCK_MONOTONIC, &t1);
 
@@ -145,8 +354,23 @@ int main(int argc, char *argv[]) {
     printf(" resultado: %.12f;", resultado_paralelo);
     printf(" tp: %.6f;", tp); ///tempo total paralelo em s
     printf(" ts: 0.0;"); ///tempo total sequencial em s
+    printf(" unroll: %d;", unroll);
+    printf(" corte_serial: %d;", corte_serial);
     printf("\n");
-    
+
+    // Produto escalar: 2 FLOPs (mult + soma) e 2 doubles lidos por elemento
+    if (usar_roofline) {
+        roofline_t roof;
+        roofline_iniciar(&roof);
+        roofline_carregar(&roof);
+        roofline_reportar(&roof, num_threads, 2.0 * tam_vetor,
+                          2.0 * sizeof(double) * tam_vetor, tp);
+    }
+
+    if (trace) {
+        trace_salvar_json(trace, arquivo_trace, "produto_paralelo");
+        trace_liberar(trace);
+    }
 
     free(vetor1); free(vetor2); free(threads); free(args);
     return 0;
@@ -1,12 +1,26 @@
 // gcc -std=c11 -Wall -Wextra -pedantic -O3 -pthread matriz_paralelo.c -o matpar
 // ./matpar 1000 4
+// ./matpar 1000 4 --roofline   (posiciona a execução no roofline do host)
+// ./matpar 1000 4 --trace matpar.json   (linha do tempo das threads, Chrome trace)
+// ./matpar 1000 0   (threads, bloco, microkernel e chunk vindos do cache de autotune)
+// ./matpar 1000 4 --tune   (refaz a busca de parâmetros para este host)
 #define _POSIX_C_SOURCE 200809L
 #include <stdio.h>
 #include <stdlib.h>
 #include <pthread.h>
+#include <stdatomic.h>
 #include <time.h>
 #include <unistd.h>
 #include <string.h>
+#include "../comum/roofline.h"
+#include "../comum/trace.h"
+#include "../comum/autotune.h"
+
+// Linhas de C por bloco registrado no trace
+#define BLOCO_LINHAS 16
+
+#define AUTOTUNE_ARQUIVO "autotune_matriz.cache"
+#define AUTOTUNE_N_SONDA 512
 
 // Estrutura de argumentos para as threads
 typedef struct {
@@ -16,6 +30,12 @@ typedef struct {
     int N;
     int start_row; // Linha inicial que a thread vai calcular
     int end_row;   // Linha final (exclusiva)
+    int bloco;      // lado do bloco em j e k (0 = sem blocagem)
+    int micro;      // microkernel: 1 = 1x1, 2 = 2x2 em registradores
+    int chunk;      // linhas por pedido dinâmico (0 = divisão estática)
+    atomic_int *proxima_linha; // contador compartilhado quando chunk > 0
+    trace_t *trace; // NULL quando --trace não foi pedido
+    int trace_buf;  // buffer exclusivo desta thread
 } thread_arg_t;
 
 /* Função Worker (Faz o trabalho pesado)
@@ -36,19 +56,14 @@ void *multiplicarMatrizParalelo(void *arg) {
     return NULL;
 }*/
 
-// Função Worker OTIMIZADA (Usa a matriz B já transposta)
-void *multiplicarMatrizParalelo(void *arg) {
-    thread_arg_t *ta = (thread_arg_t *) arg;
-    int N = ta->N;
-    double *A = ta->A;
-    double *B_T = ta->B; // O ponteiro recebido JÁ É A TRANSPOSTA
-    double *C = ta->C;
-
-    // Loop apenas nas linhas designadas para esta thread
-    for (int i = ta->start_row; i < ta->end_row; i++) {
-        for (int j = 0; j < N; j++) {
-            double soma = 0.0;
-            for (int k = 0; k < N; k++) {
+// Microkernel 1x1: C[i][j] (+)= soma de A[i][k] * B_T[j][k] para k em [k0, k1).
+// Com k0 == 0 o valor anterior de C é descartado (mesmo resultado do laço original).
+static void micro_1x1(const double *A, const double *B_T, double *C, int N,
+                      int i0, int i1, int j0, int j1, int k0, int k1) {
+    for (int i = i0; i < i1; i++) {
+        for (int j = j0; j < j1; j++) {
+            double soma = k0 == 0 ? 0.0 : C[i * N + j];
+            for (int k = k0; k < k1; k++) {
                 // OTIMIZAÇÃO AQUI:
                 // A[i][k] * B_T[j][k] (Acesso linear em ambas!)
                 // Note que acessamos B_T usando [j * N + k]
@@ -57,6 +72,82 @@ void *multiplicarMatrizParalelo(void *arg) {
             C[i * N + j] = soma;
         }
     }
+}
+
+// Microkernel 2x2: cada A[i][k] e B_T[j][k] carregado serve a 2 somas,
+// metade das leituras por FLOP. Bordas ímpares caem no 1x1.
+static void micro_2x2(const double *A, const double *B_T, double *C, int N,
+                      int i0, int i1, int j0, int j1, int k0, int k1) {
+    int i = i0;
+    for (; i + 1 < i1; i += 2) {
+        const double *a0 = &A[i * N], *a1 = &A[(i + 1) * N];
+        int j = j0;
+        for (; j + 1 < j1; j += 2) {
+            const double *b0 = &B_T[j * N], *b1 = &B_T[(j + 1) * N];
+            double c00 = 0.0, c01 = 0.0, c10 = 0.0, c11 = 0.0;
+            if (k0 != 0) {
+                c00 = C[i * N + j];       c01 = C[i * N + j + 1];
+                c10 = C[(i + 1) * N + j]; c11 = C[(i + 1) * N + j + 1];
+            }
+            for (int k = k0; k < k1; k++) {
+                c00 += a0[k] * b0[k];
+                c01 += a0[k] * b1[k];
+                c10 += a1[k] * b0[k];
+                c11 += a1[k] * b1[k];
+            }
+            C[i * N + j] = c00;       C[i * N + j + 1] = c01;
+            C[(i + 1) * N + j] = c10; C[(i + 1) * N + j + 1] = c11;
+        }
+        if (j < j1) micro_1x1(A, B_T, C, N, i, i + 2, j, j1, k0, k1);
+    }
+    if (i < i1) micro_1x1(A, B_T, C, N, i, i1, j0, j1, k0, k1);
+}
+
+// Calcula as linhas [i0, i1) de C, em blocos bloco x bloco de (j, k)
+// para o pedaço de B_T em uso continuar no cache entre as linhas.
+static void calcular_linhas(const thread_arg_t *ta, int i0, int i1) {
+    int N = ta->N;
+    int passo = ta->bloco > 0 ? ta->bloco : N;
+    for (int jj = 0; jj < N; jj += passo) {
+        int j1 = jj + passo < N ? jj + passo : N;
+        for (int kk = 0; kk < N; kk += passo) {
+            int k1 = kk + passo < N ? kk + passo : N;
+            if (ta->micro == 2) micro_2x2(ta->A, ta->B, ta->C, N, i0, i1, jj, j1, kk, k1);
+            else micro_1x1(ta->A, ta->B, ta->C, N, i0, i1, jj, j1, kk, k1);
+        }
+    }
+}
+
+// Função Worker OTIMIZADA (Usa a matriz B já transposta)
+void *multiplicarMatrizParalelo(void *arg) {
+    thread_arg_t *ta = (thread_arg_t *) arg;
+    int N = ta->N;
+    double t_inicio = trace_agora(ta->trace);
+    int linhas = 0;
+
+    if (ta->chunk > 0) {
+        // Divisão dinâmica: cada thread pega o próximo chunk de linhas livre
+        for (;;) {
+            int b = atomic_fetch_add(ta->proxima_linha, ta->chunk);
+            if (b >= N) break;
+            int fim = b + ta->chunk < N ? b + ta->chunk : N;
+            double t_chunk = trace_agora(ta->trace);
+            calcular_linhas(ta, b, fim);
+            trace_registrar(ta->trace, ta->trace_buf, "chunk", t_chunk, trace_agora(ta->trace), b);
+            linhas += fim - b;
+        }
+    } else {
+        // Loop apenas nas linhas designadas para esta thread,
+        // em blocos de BLOCO_LINHAS para marcar cada um no trace
+        for (int b = ta->start_row; b < ta->end_row; b += BLOCO_LINHAS) {
+            int fim = b + BLOCO_LINHAS < ta->end_row ? b + BLOCO_LINHAS : ta->end_row;
+            double t_bloco = trace_agora(ta->trace);
+            calcular_linhas(ta, b, fim);
+            trace_registrar(ta->trace, ta->trace_buf, "bloco", t_bloco, trace_agora(ta->trace), b);
+        }
+        linhas = ta->end_row - ta->start_row;
+    }
+    trace_registrar(ta->trace, ta->trace_buf, "kernel", t_inicio, trace_agora(ta->trace), linhas);
     return NULL;
 }
 
@@ -64,6 +155,123 @@ static double timespec_diff_seconds(struct timespec a, struct timespec b) {
     return (b.tv_sec - a.tv_sec) + (b.tv_nsec - a.tv_nsec) / 1e9;
 }
 
+// Parâmetros de kernel na ordem do cache: threads, bloco, micro, chunk
+enum { P_THREADS, P_BLOCO, P_MICRO, P_CHUNK, N_PARAMS };
+
+// Cria num_threads workers para C = A * B (B já transposta) e espera todos
+static void executar_paralelo(double *A, double *B_T, double *C, int N, int num_threads,
+                              const autotune_param_t *params, trace_t *trace,
+                              pthread_t *threads, thread_arg_t *args) {
+    // Divisão de Carga (Load Balancing) igual ao código do seu amigo
+    int base = N / num_threads;
+    int resto = N % num_threads;
+    int offset = 0;
+    atomic_int proxima_linha = 0;
+
+    for (int t = 0; t < num_threads; ++t) {
+        int rows = base + (t < resto ? 1 : 0); // Distribui o resto
+        
+        args[t].A = A;
+        args[t].B = B_T; // TRANSPOSTA
+        args[t].C = C;
+        args[t].N = N;
+        args[t].start_row = offset;
+        args[t].end_row = offset + rows;
+        args[t].bloco = params[P_BLOCO].valor;
+        args[t].micro = params[P_MICRO].valor;
+        args[t].chunk = params[P_CHUNK].valor;
+        args[t].proxima_linha = &proxima_linha;
+        args[t].trace = trace;
+        args[t].trace_buf = t + 1;
+
+        double t_create = trace_agora(trace);
+        pthread_create(&threads[t], NULL, multiplicarMatrizParalelo, &args[t]);
+        trace_registrar(trace, 0, "pthread_create", t_create, trace_agora(trace), t);
+        
+        offset += rows;
+    }
+
+    for (int t = 0; t < num_threads; ++t) {
+        double t_join = trace_agora(trace);
+        pthread_join(threads[t], NULL);
+        trace_registrar(trace, 0, "pthread_join", t_join, trace_agora(trace), t);
+    }
+}
+
+// --- AUTOTUNE ---
+// Menor tempo de 'reps' execuções com os parâmetros dados
+static double medir_matriz(double *A, double *B_T, double *C, int N,
+                           const autotune_param_t *params, int reps) {
+    pthread_t threads[256];
+    thread_arg_t args[256];
+    double melhor = 1e30;
+    for (int r = 0; r < reps; r++) {
+        double t0 = autotune_agora();
+        executar_paralelo(A, B_T, C, N, params[P_THREADS].valor, params, NULL, threads, args);
+        double dt = autotune_agora() - t0;
+        if (dt < melhor) melhor = dt;
+    }
+    return melhor;
+}
+
+// Testa os candidatos de um parâmetro mantendo os outros fixos; fica com o
+// primeiro candidato a menos que outro seja mais de 3% mais rápido.
+static void autotune_coordenada(double *A, double *B_T, double *C, int N,
+                                autotune_param_t *params, int p,
+                                const int *candidatos, int n_candidatos) {
+    int melhor_v = candidatos[0];
+    double melhor = 1e30;
+    for (int i = 0; i < n_candidatos; i++) {
+        params[p].valor = candidatos[i];
+        double dt = medir_matriz(A, B_T, C, N, params, 3);
+        if (dt < 0.97 * melhor) { melhor = dt; melhor_v = candidatos[i]; }
+    }
+    params[p].valor = melhor_v;
+}
+
+// Busca coordenada numa matriz de sonda: threads -> bloco x micro -> chunk
+static int autotune_matriz(autotune_param_t *params, long cpus) {
+    int N = AUTOTUNE_N_SONDA;
+    double *A = malloc((size_t) N * N * sizeof(double));
+    double *B_T = malloc((size_t) N * N * sizeof(double));
+    double *C = malloc((size_t) N * N * sizeof(double));
+    if (!A || !B_T || !C) {
+        perror("malloc autotune");
+        free(A); free(B_T); free(C);
+        return -1;
+    }
+    for (int i = 0; i < N * N; i++) {
+        A[i] = (double) rand() / RAND_MAX;
+        B_T[i] = (double) rand() / RAND_MAX;
+    }
+
+    int threads[16], n_threads = 0;
+    for (int t = 1; t <= 2 * cpus && t <= 256 && n_threads < 16; t *= 2) threads[n_threads++] = t;
+    autotune_coordenada(A, B_T, C, N, params, P_THREADS, threads, n_threads);
+
+    // bloco e microkernel interagem (registradores x cache), então testa o produto
+    static const int blocos[] = {0, 32, 64, 128};
+    static const int micros[] = {1, 2};
+    int melhor_b = 0, melhor_m = 1;
+    double melhor = 1e30;
+    for (int b = 0; b < 4; b++) {
+        for (int m = 0; m < 2; m++) {
+            params[P_BLOCO].valor = blocos[b];
+            params[P_MICRO].valor = micros[m];
+            double dt = medir_matriz(A, B_T, C, N, params, 3);
+            if (dt < 0.97 * melhor) { melhor = dt; melhor_b = blocos[b]; melhor_m = micros[m]; }
+        }
+    }
+    params[P_BLOCO].valor = melhor_b;
+    params[P_MICRO].valor = melhor_m;
+
+    static const int chunks[] = {0, 2, 8, 32};
+    autotune_coordenada(A, B_T, C, N, params, P_CHUNK, chunks, 4);
+
+    free(A); free(B_T); free(C);
+    return 0;
+}
+
 int main(int argc, char *argv[]) {
     int N = 0, num_threads = 0;
     double *A = NULL, *B = NULL, *C = NULL;
@@ -71,18 +279,64 @@ int main(int argc, char *argv[]) {
     if (cpus < 1) cpus = 1;
 
     if (argc < 3) {
-        fprintf(stderr, "Uso: %s <tamanho_matriz> <num_threads>\n", argv[0]);
+        fprintf(stderr, "Uso: %s <tamanho_matriz> <num_threads> [--roofline] [--trace arquivo.json] [--tune | --sem-tune]\n", argv[0]);
+        fprintf(stderr, "num_threads 0 = valor do autotune\n");
         return 1;
     }
 
     N = atoi(argv[1]);
     num_threads = atoi(argv[2]);
 
-    if (N <= 0 || num_threads <= 0) {
+    if (N <= 0 || num_threads < 0) {
         fprintf(stderr, "Parametros invalidos.\n");
         return 1;
     }
 
+    int usar_roofline = 0;
+    int forcar_tune = 0, sem_tune = 0;
+    const char *arquivo_trace = NULL;
+    for (int i = 3; i < argc; i++) {
+        if (strcmp(argv[i], "--roofline") == 0) usar_roofline = 1;
+        else if (strcmp(argv[i], "--trace") == 0 && i + 1 < argc) arquivo_trace = argv[++i];
+        else if (strcmp(argv[i], "--tune") == 0) forcar_tune = 1;
+        else if (strcmp(argv[i], "--sem-tune") == 0) sem_tune = 1;
+        else {
+            fprintf(stderr, "Opcao desconhecida: %s\n", argv[i]);
+            return 1;
+        }
+    }
+
+    // Padrões = kernel original (sem blocagem, 1x1, divisão estática).
+    // Sem linha no cache para este hardware, a busca roda e grava os vencedores.
+    const autotune_param_t padrao[N_PARAMS] = {
+        [P_THREADS] = {"threads", (int) cpus},
+        [P_BLOCO] = {"bloco", 0},
+        [P_MICRO] = {"micro", 1},
+        [P_CHUNK] = {"chunk", 0},
+    };
+    autotune_param_t params[N_PARAMS];
+    memcpy(params, padrao, sizeof(params));
+    // Só o modo automático (num_threads 0) usa o cache; com threads explícitas
+    // nem lê nem busca, a não ser com --tune
+    if (!sem_tune && (num_threads == 0 || forcar_tune)) {
+        char fp[300];
+        autotune_fingerprint(fp, sizeof(fp));
+        const char *caminho = autotune_caminho(AUTOTUNE_ARQUIVO);
+        if (forcar_tune || !autotune_carregar(caminho, fp, params, N_PARAMS)) {
+            fprintf(stderr, "[AUTOTUNE] Buscando parametros para %s...\n", fp);
+            if (autotune_matriz(params, cpus) == 0) {
+                autotune_salvar(caminho, fp, params, N_PARAMS);
+                fprintf(stderr, "[AUTOTUNE] threads=%d bloco=%d micro=%d chunk=%d\n",
+                        params[P_THREADS].valor, params[P_BLOCO].valor,
+                        params[P_MICRO].valor, params[P_CHUNK].valor);
+            }
+        }
+    }
+    // num_threads 0: tudo do autotune. Com threads explícitas roda o kernel
+    // original, para o tempo não depender do cache que estiver no disco.
+    if (num_threads == 0) num_threads = params[P_THREADS].valor > 0 ? params[P_THREADS].valor : 1;
+    else memcpy(params, padrao, sizeof(params));
+
     // Se tiver mais threads que linhas, limita as threads
     if (num_threads > N) num_threads = N;
 
@@ -123,32 +377,22 @@ int main(int argc, char *argv[]) {
     pthread_t *threads = malloc(num_threads * sizeof(pthread_t));
     thread_arg_t *args = malloc(num_threads * sizeof(thread_arg_t));
 
-    // Divisão de Carga (Load Balancing) igual ao código do seu amigo
-    int base = N / num_threads;
-    int resto = N % num_threads;
-    int offset = 0;
-
-    clock_gettime(CLOCK_MONOTONIC, &t0);
-
-    for (int t = 0; t < num_threads; ++t) {
-        int rows = base + (t < resto ? 1 : 0); // Distribui o resto
-        
-        args[t].A = A;
-        args[t].B = B_T; // TRANSPOSTA
-        args[t].C = C;
-        args[t].N = N;
-        args[t].start_row = offset;
-        args[t].end_row = offset + rows;
-
-        pthread_create(&threads[t], NULL, multiplicarMatrizParalelo, &args[t]);
-        
-        offset += rows;
-    }
-
-    for (int t = 0; t < num_threads; ++t) {
-        pthread_join(threads[t], NULL);
+    // Buffer 0 = thread principal (create/join), 1..num_threads = workers
+    trace_t trace_dados = {0};
+    trace_t *trace = NULL;
+    if (arquivo_trace) {
+        if (trace_iniciar(&trace_dados, num_threads + 1, TRACE_CAP_PADRAO) != 0) {
+            perror("malloc trace");
+            trace_liberar(&trace_dados);
+            free(A); free(B); free(C); free(B_T);
+            free(threads); free(args);
+            return 1;
+        }
+        trace = &trace_dados;
     }
 
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    executar_paralelo(A, B_T, C, N, num_threads, params, trace, threads, args);
     clock_gettime(CLOCK_MONOTONIC, &t1);
     double tp = timespec_diff_seconds(t0, t1);
 
@@ -164,8 +408,26 @@ int main(int argc, char *argv[]) {
     printf(" checksum: %.2f;", check_sum);
     printf(" tp: %.6f;", tp);
     printf(" ts: 0.0;");
+    printf(" bloco: %d;", params[P_BLOCO].valor);
+    printf(" micro: %d;", params[P_MICRO].valor);
+    printf(" chunk: %d;", params[P_CHUNK].valor);
     printf("\n");
 
+    // 2N^3 FLOPs. Tráfego mínimo (compulsório): ler A e B_T e escrever C uma
+    // vez, 3N^2 doubles; a AI real é menor quando as linhas não cabem no cache.
+    if (usar_roofline) {
+        roofline_t roof;
+        roofline_iniciar(&roof);
+        roofline_carregar(&roof);
+        roofline_reportar(&roof, num_threads, 2.0 * N * N * (double) N,
+                          3.0 * sizeof(double) * N * (double) N, tp);
+    }
+
+    if (trace) {
+        trace_salvar_json(trace, arquivo_trace, "matriz_paralelo");
+        trace_liberar(trace);
+    }
+
     free(A); free(B); free(C); free(B_T);
     free(threads); free(args);
     return 0;
@@ -2,6 +2,8 @@
 #chmod +x run_tests.sh
 #chmod +x run_tests.sh
 #./run_tests.sh >> resultados_experimento.txt
+# Com repetições (para comparar conjuntos com ../comum/comparar_resultados.c):
+#REPETICOES=10 ./run_tests.sh >> resultados_novos.txt
 # --- 1. Compilação ---
 echo "Compilando os programas..."
 # Compila o Sequencial
@@ -23,7 +25,11 @@ TAMANHOS=(500 1000 2000 3000)
 # Quantidade de threads
 THREADS=(4 8 16 32)
 
+# Quantas vezes cada configuração roda
+REPETICOES=${REPETICOES:-1}
+
 # --- 3. Execução ---
+for rep in $(seq 1 "$REPETICOES"); do
 for size in "${TAMANHOS[@]}"; do
     
     # A) Executa o SEQUENCIAL uma vez para esse tamanho
@@ -35,5 +41,6 @@ for size in "${TAMANHOS[@]}"; do
     done
 
 done
+done
 
 echo "Testes finalizados!" 
\ No newline at end of file
@@ -1,18 +1,84 @@
+// gcc -Wall -Wextra -O2 -pthread agc_simulator_paralelo.c -o agc_par
+// ./agc_par
+// ./agc_par --bench-log 64 10000 > /dev/null   (log direto x assíncrono)
+// ./agc_par --downlink   (publica quadros binários; ler com ./downlink_cons)
+// ./agc_par --bench-downlink 4 1000000   (com ./downlink_cons rodando em paralelo)
+// ./agc_par --constelacao 100000 8 [ticks] [semente]   (N satélites, W workers; ver run_constelacao.sh)
+// kill -USR1 <pid>   (imprime os histogramas de latência em stderr; também saem no SAIR)
+// ./agc_par --seed 42 --threads 4 --script roteiro.txt [--virtual]
+//   Sem terminal: executa os comandos do roteiro (ver simulacao.h) no relógio
+//   real ou, com --virtual, num relógio virtual de eventos discretos. Com a
+//   mesma semente e roteiro os dois modos geram os mesmos eventos "[T+...]".
+// ./agc_par --script dia.txt --virtual --checkpoint estado.ckpt [--intervalo 60]
+// ./agc_par --script dia.txt --virtual --restaurar estado.ckpt
+//   Grava o estado inteiro a cada 'intervalo' s de simulação; --restaurar
+//   continua do último checkpoint (também no modo real e no interativo).
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <stdint.h>
+#include <stdatomic.h>
 #include <pthread.h>
 #include <unistd.h>
 #include <sys/syscall.h>
+#include <sys/epoll.h>
+#include <sys/timerfd.h>
+#include <sys/eventfd.h>
+#include <sys/resource.h>
+#include <sys/uio.h>
+#include <sys/signalfd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <signal.h>
 #include <time.h>
 #include <termios.h>
 #include <ctype.h>
+#include <limits.h>
+#include "simulacao.h"
+#include "downlink_frame.h"
+#include "histograma.h"
 
 // --- ESTADO DO SATÉLITE ---
-int bateria = 100;
-int temperatura = 25;
-char status_sistema[100] = "EM ORBITA (STANDBY)";
+// Publicado como um seqlock: os escritores se serializam em mutex_estado
+// (só pelo tempo de copiar quatro inteiros, nunca durante I/O) e os leitores
+// tiram uma cópia consistente sem lock nenhum, repetindo se pegarem uma
+// escrita no meio. O status virou código + parâmetro para caber em campos
+// atômicos; o texto é montado só na hora de imprimir.
+enum {
+    STATUS_STANDBY,          // "EM ORBITA (STANDBY)"
+    STATUS_MANOBRA,          // "EXECUTANDO MANOBRA DE ORBITA (%ds)..."
+    STATUS_ORBITA_ESTAVEL,   // "PROPULSORES DESLIGADOS. ORBITA ESTAVEL."
+    STATUS_RECARREGADO       // "SISTEMA RECARREGADO."
+};
+
+// Cópia do estado (snapshot) usada fora do seqlock
+typedef struct {
+    int bateria;
+    int temperatura;
+    int status;
+    int duracao_manobra; // parâmetro de STATUS_MANOBRA
+} estado_t;
+
+atomic_uint estado_seq = 0; // ímpar = escrita em andamento
+atomic_int estado_bateria = 100;
+atomic_int estado_temperatura = 25;
+atomic_int estado_status = STATUS_STANDBY;
+atomic_int estado_duracao = 0;
+
 int simulacao_rodando = 1;
+int modo_script = 0; // 1 = comandos vêm do roteiro, saída em texto puro
+int roteiro_erro = 0; // linha do roteiro com erro de formato (0 = nenhuma)
+
+// Instante nominal (tempo de simulação) do evento que esta thread está
+// tratando. Vai nos logs em vez do relógio de parede, então o atraso de
+// escalonamento do modo real não muda a saída.
+_Thread_local unsigned long tempo_evento_ns = 0;
+
+// Downlink binário (--downlink): cada tick de telemetria e cada passo da
+// transmissão publicam um quadro no anel compartilhado
+downlink_anel_t downlink = {0};
+int downlink_ativo = 0;
 
 // Buffer Global de Input
 char input_buffer[256] = {0};
@@ -21,6 +87,149 @@ int input_pos = 0;
 pthread_mutex_t mutex_estado = PTHREAD_MUTEX_INITIALIZER;
 pthread_mutex_t mutex_io = PTHREAD_MUTEX_INITIALIZER; 
 
+// --- HISTOGRAMAS DE LATÊNCIA (ns) ---
+// tick_atraso: quanto cada tick de telemetria rodou depois do horário previsto
+// tick_jitter: |período real - período previsto| entre ticks seguidos do monitor
+// comando_ack: do comando chegar (ENTER ou instante do roteiro) até a primeira
+//              resposta dele estar no terminal
+// espera_*:    tempo esperando para pegar mutex_estado / mutex_io
+histograma_t hist_tick_atraso = HISTOGRAMA_INICIAL("tick_atraso");
+histograma_t hist_tick_jitter = HISTOGRAMA_INICIAL("tick_jitter");
+histograma_t hist_comando = HISTOGRAMA_INICIAL("comando_ack");
+histograma_t hist_espera_estado = HISTOGRAMA_INICIAL("espera_estado");
+histograma_t hist_espera_io = HISTOGRAMA_INICIAL("espera_io");
+
+void despejar_histogramas(FILE *f) {
+    hist_imprimir(f, &hist_tick_atraso);
+    hist_imprimir(f, &hist_tick_jitter);
+    hist_imprimir(f, &hist_comando);
+    hist_imprimir(f, &hist_espera_estado);
+    hist_imprimir(f, &hist_espera_io);
+}
+
+// Início (tempo de simulação) do comando que esta thread está tratando e
+// que ainda não respondeu (o roteiro pode ter comando no instante 0, daí
+// o marcador). A primeira linha de log consome.
+#define SEM_ACK ULONG_MAX
+_Thread_local unsigned long ack_desde_ns = SEM_ACK;
+
+// --- LAÇO DE EVENTOS ---
+// O main espera tudo num único epoll: teclado, um timerfd por monitor de
+// telemetria e nada mais. Quando o timer de um monitor vence, o main avisa a
+// thread dele pelo eventfd; as threads de telemetria dormem no read() do
+// eventfd em vez de usleep, então ninguém acorda sem ter o que fazer.
+// Cada monitor tem dois geradores próprios (sorteio do tick e do intervalo)
+// e um horário nominal de tick, o que torna a sequência de eventos função só
+// da semente, seja no relógio real ou no virtual.
+typedef struct {
+    pthread_t thread;
+    int indice;
+    int timer_fd;   // período do monitor (one-shot, rearmado a cada tick)
+    int evento_fd;  // main -> thread: "faça um tick" (ou saia, no fim)
+    sim_rng_t rng_tick;
+    sim_rng_t rng_timer;
+    unsigned long proximo_ns;  // próximo tick (tempo de simulação)
+    atomic_ulong tick_ns;      // tick que a thread deve processar
+    unsigned long feito_ns;    // último tick processado (escrito com mutex_estado)
+    unsigned long pendente_ns; // tick restaurado ainda por processar (SEM_TICK = nenhum)
+    unsigned long ultimo_real, ultimo_previsto; // tick anterior (só a thread usa)
+} monitor_t;
+
+#define SEM_TICK ULONG_MAX
+
+// Tempo de posse e de espera de mutex_estado (ns), para as métricas de saída
+atomic_ulong lock_secoes = 0;
+atomic_ulong lock_posse_total = 0;
+atomic_ulong lock_posse_max = 0;
+atomic_ulong lock_espera_total = 0;
+struct timespec lock_adquirido; // só o dono do mutex usa
+
+static unsigned long agora_ns(void) {
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return (unsigned long) t.tv_sec * 1000000000UL + t.tv_nsec;
+}
+
+// Leitura sem lock: repete enquanto houver escrita em andamento ou concorrente
+estado_t estado_ler(void) {
+    estado_t e;
+    unsigned s1, s2 = 0;
+    do {
+        s1 = atomic_load_explicit(&estado_seq, memory_order_acquire);
+        if (s1 & 1) continue;
+        e.bateria = atomic_load_explicit(&estado_bateria, memory_order_relaxed);
+        e.temperatura = atomic_load_explicit(&estado_temperatura, memory_order_relaxed);
+        e.status = atomic_load_explicit(&estado_status, memory_order_relaxed);
+        e.duracao_manobra = atomic_load_explicit(&estado_duracao, memory_order_relaxed);
+        atomic_thread_fence(memory_order_acquire);
+        s2 = atomic_load_explicit(&estado_seq, memory_order_relaxed);
+    } while ((s1 & 1) || s1 != s2);
+    return e;
+}
+
+// Início de uma escrita: pega o mutex dos escritores e devolve o estado atual
+estado_t estado_travar(void) {
+    unsigned long t0 = agora_ns();
+    pthread_mutex_lock(&mutex_estado);
+    unsigned long t1 = agora_ns();
+    atomic_fetch_add_explicit(&lock_espera_total, t1 - t0, memory_order_relaxed);
+    hist_registrar(&hist_espera_estado, t1 - t0);
+    clock_gettime(CLOCK_MONOTONIC, &lock_adquirido);
+
+    estado_t e;
+    e.bateria = atomic_load_explicit(&estado_bateria, memory_order_relaxed);
+    e.temperatura = atomic_load_explicit(&estado_temperatura, memory_order_relaxed);
+    e.status = atomic_load_explicit(&estado_status, memory_order_relaxed);
+    e.duracao_manobra = atomic_load_explicit(&estado_duracao, memory_order_relaxed);
+    return e;
+}
+
+// Fim da escrita: publica o novo estado e solta o mutex
+void estado_publicar(const estado_t *e) {
+    unsigned s = atomic_load_explicit(&estado_seq, memory_order_relaxed);
+    atomic_store_explicit(&estado_seq, s + 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+    atomic_store_explicit(&estado_bateria, e->bateria, memory_order_relaxed);
+    atomic_store_explicit(&estado_temperatura, e->temperatura, memory_order_relaxed);
+    atomic_store_explicit(&estado_status, e->status, memory_order_relaxed);
+    atomic_store_explicit(&estado_duracao, e->duracao_manobra, memory_order_relaxed);
+    atomic_store_explicit(&estado_seq, s + 2, memory_order_release);
+
+    unsigned long posse = agora_ns() -
+        ((unsigned long) lock_adquirido.tv_sec * 1000000000UL + lock_adquirido.tv_nsec);
+    pthread_mutex_unlock(&mutex_estado);
+
+    atomic_fetch_add_explicit(&lock_secoes, 1, memory_order_relaxed);
+    atomic_fetch_add_explicit(&lock_posse_total, posse, memory_order_relaxed);
+    unsigned long max = atomic_load_explicit(&lock_posse_max, memory_order_relaxed);
+    while (posse > max &&
+           !atomic_compare_exchange_weak_explicit(&lock_posse_max, &max, posse,
+                                                  memory_order_relaxed, memory_order_relaxed));
+}
+
+void texto_status(const estado_t *e, char *buf, size_t tam) {
+    switch (e->status) {
+        case STATUS_MANOBRA:
+            snprintf(buf, tam, "EXECUTANDO MANOBRA DE ORBITA (%ds)...", e->duracao_manobra);
+            break;
+        case STATUS_ORBITA_ESTAVEL:
+            snprintf(buf, tam, "PROPULSORES DESLIGADOS. ORBITA ESTAVEL.");
+            break;
+        case STATUS_RECARREGADO:
+            snprintf(buf, tam, "SISTEMA RECARREGADO.");
+            break;
+        default:
+            snprintf(buf, tam, "EM ORBITA (STANDBY)");
+    }
+}
+
+// pthread_mutex_lock(&mutex_io) medindo a espera
+void io_travar(void) {
+    unsigned long t0 = agora_ns();
+    pthread_mutex_lock(&mutex_io);
+    hist_registrar(&hist_espera_io, agora_ns() - t0);
+}
+
 struct termios orig_termios;
 
 void disableRawMode() {
@@ -35,235 +244,1795 @@ void enableRawMode() {
     tcsetattr(STDIN_FILENO, TCSAFLUSH, &raw);
 }
 
-// --- FUNÇÃO DE PRINT SEGURO (PARA THREADS DE FUNDO) ---
-void print_log_seguro(char* msg, long thread_id, int tipo_msg) {
-    pthread_mutex_lock(&mutex_io);
-
-    printf("\r\033[K"); 
-
-    // Cores
-    if (tipo_msg == 1) printf("\033[1;31m");      // Vermelho
-    else if (tipo_msg == 2) printf("\033[1;33m"); // Amarelo
-    else if (tipo_msg == 3) printf("\033[1;34m"); // Azul
-    else if (tipo_msg == 4) printf("\033[1;35m"); // Roxo
-    else printf("\033[1;30m");                    // Cinza
+// Cores por tipo de mensagem
+static const char *cor_log(int tipo_msg) {
+    if (tipo_msg == 1) return "\033[1;31m";      // Vermelho
+    else if (tipo_msg == 2) return "\033[1;33m"; // Amarelo
+    else if (tipo_msg == 3) return "\033[1;34m"; // Azul
+    else if (tipo_msg == 4) return "\033[1;35m"; // Roxo
+    else return "\033[1;30m";                    // Cinza
+}
 
-    if (thread_id > 0)
-        printf("[THREAD %ld] %s\033[0m\n", thread_id, msg);
+// Formata uma linha de log (sem o prompt) em buf; devolve o tamanho.
+// No modo roteiro a linha é texto puro, prefixada pelo tempo de simulação.
+static int formatar_log(char *buf, size_t tam, const char *msg, long thread_id, int tipo_msg,
+                        unsigned long tempo_ns) {
+    int n;
+    if (modo_script) {
+        const char *origem = thread_id > 0 ? "THREAD" : (tipo_msg == 4 ? "RADIO" : "SISTEMA");
+        char id[24] = "";
+        if (thread_id > 0) snprintf(id, sizeof(id), " %ld", thread_id);
+        n = snprintf(buf, tam, "[T+%12.3f] [%s%s] %s\n", tempo_ns / 1e9, origem, id, msg);
+    }
+    else if (thread_id > 0)
+        n = snprintf(buf, tam, "\r\033[K%s[THREAD %ld] %s\033[0m\n", cor_log(tipo_msg), thread_id, msg);
     else if (tipo_msg == 4)
-        printf("[RADIO] %s\033[0m\n", msg);
+        n = snprintf(buf, tam, "\r\033[K%s[RADIO] %s\033[0m\n", cor_log(tipo_msg), msg);
     else
-        printf("[SISTEMA] %s\033[0m\n", msg);
+        n = snprintf(buf, tam, "\r\033[K%s[SISTEMA] %s\033[0m\n", cor_log(tipo_msg), msg);
+    return n < (int) tam ? n : (int) tam - 1;
+}
 
-   
-    printf("COMANDO > %s", input_buffer);
-    fflush(stdout);
+// --- PRINT DIRETO (CAMINHO ANTIGO) ---
+// Formata e escreve na hora, sob mutex_io. Só é usado quando o escritor
+// assíncrono não está rodando e como referência no --bench-log.
+void print_log_direto(const char* msg, long thread_id, int tipo_msg) {
+    char linha[256];
+    formatar_log(linha, sizeof(linha), msg, thread_id, tipo_msg, tempo_evento_ns);
 
+    io_travar();
+    fputs(linha, stdout);
+    if (!modo_script) { // no roteiro não há prompt nem pressa de aparecer
+        printf("COMANDO > %s", input_buffer);
+        fflush(stdout);
+    }
     pthread_mutex_unlock(&mutex_io);
+    if (ack_desde_ns != SEM_ACK) {
+        hist_registrar(&hist_comando, sim_agora_ns() - ack_desde_ns);
+        ack_desde_ns = SEM_ACK;
+    }
+}
+
+// --- LOG ASSÍNCRONO ---
+// Anel MPSC limitado (esquema de Vyukov): cada slot tem um número de
+// sequência que diz se está livre para o produtor da posição p (seq == p)
+// ou pronto para o consumidor (seq == p + 1). Produtores só fazem um CAS
+// na cauda e copiam um registro de tamanho fixo; se o anel está cheio a
+// mensagem é descartada e contada, nunca bloqueia. Uma thread escritora
+// formata os registros e manda o lote inteiro num único writev.
+#define LOG_CAPACIDADE 4096 // potência de 2
+#define LOG_MSG_MAX 100
+#define LOG_LOTE 64
+
+typedef struct {
+    atomic_size_t seq;
+    long thread_id;
+    int tipo;
+    unsigned long tempo_ns;
+    unsigned long ack_desde_ns; // resposta a um comando: mede ao escrever
+    char msg[LOG_MSG_MAX];
+} log_registro_t;
+
+log_registro_t log_anel[LOG_CAPACIDADE];
+atomic_size_t log_cauda = 0;    // próxima posição dos produtores
+size_t log_cabeca = 0;          // próxima posição do escritor (só ele usa)
+atomic_int log_pendente = 0;    // 1 = escritor já foi avisado
+atomic_int log_encerrar = 0;
+atomic_int log_ativo = 0;
+atomic_ulong log_enfileirados = 0;
+atomic_ulong log_descartados = 0;
+atomic_ulong log_escritos = 0;
+int log_evento_fd = -1;
+pthread_t log_thread;
+
+// Produtor: copia a mensagem para um slot livre, sem lock. Devolve 0 se
+// a mensagem foi descartada (anel cheio), 1 caso contrário.
+int print_log_seguro(const char* msg, long thread_id, int tipo_msg) {
+    if (!atomic_load_explicit(&log_ativo, memory_order_acquire)) {
+        print_log_direto(msg, thread_id, tipo_msg);
+        return 1;
+    }
+
+    size_t pos = atomic_load_explicit(&log_cauda, memory_order_relaxed);
+    log_registro_t *r;
+    for (;;) {
+        r = &log_anel[pos & (LOG_CAPACIDADE - 1)];
+        size_t seq = atomic_load_explicit(&r->seq, memory_order_acquire);
+        intptr_t dif = (intptr_t) seq - (intptr_t) pos;
+        if (dif == 0) {
+            if (atomic_compare_exchange_weak_explicit(&log_cauda, &pos, pos + 1,
+                                                      memory_order_relaxed, memory_order_relaxed))
+                break;
+        } else if (dif < 0) { // anel cheio
+            atomic_fetch_add_explicit(&log_descartados, 1, memory_order_relaxed);
+            return 0;
+        } else {
+            pos = atomic_load_explicit(&log_cauda, memory_order_relaxed);
+        }
+    }
+    r->thread_id = thread_id;
+    r->tipo = tipo_msg;
+    r->tempo_ns = tempo_evento_ns;
+    r->ack_desde_ns = ack_desde_ns;
+    ack_desde_ns = SEM_ACK;
+    strncpy(r->msg, msg, LOG_MSG_MAX - 1);
+    r->msg[LOG_MSG_MAX - 1] = '\0';
+    atomic_store_explicit(&r->seq, pos + 1, memory_order_release);
+    atomic_fetch_add_explicit(&log_enfileirados, 1, memory_order_relaxed);
+
+    // Só o primeiro produtor depois do escritor dormir paga a syscall
+    if (atomic_exchange_explicit(&log_pendente, 1, memory_order_acq_rel) == 0) {
+        uint64_t um = 1;
+        if (write(log_evento_fd, &um, sizeof(um)) < 0) perror("log eventfd");
+    }
+    return 1;
+}
+
+// Escritor: drena o anel em lotes de até LOG_LOTE linhas + prompt
+void* thread_log(void* arg) {
+    (void) arg;
+    static char texto[LOG_LOTE][160];
+    struct iovec iov[LOG_LOTE + 1];
+    char prompt[sizeof(input_buffer) + 16];
+    unsigned long acks[LOG_LOTE];
+    uint64_t n;
+
+    for (;;) {
+        if (read(log_evento_fd, &n, sizeof(n)) != sizeof(n)) break;
+        // Zera antes de drenar: quem enfileirar a partir daqui avisa de novo
+        atomic_store_explicit(&log_pendente, 0, memory_order_release);
+
+        for (;;) {
+            int lote = 0;
+            while (lote < LOG_LOTE) {
+                log_registro_t *r = &log_anel[log_cabeca & (LOG_CAPACIDADE - 1)];
+                if (atomic_load_explicit(&r->seq, memory_order_acquire) != log_cabeca + 1) break;
+                int tam = formatar_log(texto[lote], sizeof(texto[lote]), r->msg, r->thread_id, r->tipo, r->tempo_ns);
+                iov[lote].iov_base = texto[lote];
+                iov[lote].iov_len = tam;
+                acks[lote] = r->ack_desde_ns;
+                atomic_store_explicit(&r->seq, log_cabeca + LOG_CAPACIDADE, memory_order_release);
+                log_cabeca++;
+                lote++;
+            }
+            if (lote == 0) break;
+
+            io_travar();
+            fflush(stdout); // o que o main deixou no buffer do stdio sai antes
+            int n_iov = lote;
+            if (!modo_script) {
+                int tam = snprintf(prompt, sizeof(prompt), "COMANDO > %s", input_buffer);
+                iov[lote].iov_base = prompt;
+                iov[lote].iov_len = tam;
+                n_iov++;
+            }
+            if (writev(STDOUT_FILENO, iov, n_iov) < 0) perror("writev");
+            pthread_mutex_unlock(&mutex_io);
+            unsigned long escrito = sim_agora_ns();
+            for (int k = 0; k < lote; k++)
+                if (acks[k] != SEM_ACK) hist_registrar(&hist_comando, escrito - acks[k]);
+            atomic_fetch_add_explicit(&log_escritos, lote, memory_order_relaxed);
+        }
+        if (atomic_load_explicit(&log_encerrar, memory_order_acquire)) break;
+    }
+    return NULL;
+}
+
+int log_iniciar(void) {
+    for (size_t i = 0; i < LOG_CAPACIDADE; i++) atomic_init(&log_anel[i].seq, i);
+    log_evento_fd = eventfd(0, EFD_CLOEXEC);
+    if (log_evento_fd < 0 || pthread_create(&log_thread, NULL, thread_log, NULL) != 0) {
+        perror("log_iniciar");
+        return -1;
+    }
+    atomic_store_explicit(&log_ativo, 1, memory_order_release);
+    return 0;
+}
+
+// Drena o que falta e para o escritor; depois disso o log volta a ser direto
+void log_finalizar(void) {
+    atomic_store_explicit(&log_ativo, 0, memory_order_release);
+    atomic_store_explicit(&log_encerrar, 1, memory_order_release);
+    uint64_t um = 1;
+    if (write(log_evento_fd, &um, sizeof(um)) < 0) perror("log eventfd");
+    pthread_join(log_thread, NULL);
+    close(log_evento_fd);
 }
 
 long get_thread_id() {
     return syscall(SYS_gettid) % 1000;
 }
 
-//  THREAD DE TELEMETRIA 
-void* thread_telemetria(void* arg) {
-    long id = get_thread_id();
+//  TELEMETRIA 
+// Um tick de monitoramento. Roda na thread do monitor (modo real) ou
+// direto no laço de eventos (modo virtual).
+void telemetria_tick(monitor_t *mon, long id) {
     char msg[100];
+    estado_t e = estado_travar();
+
+    if (e.bateria > 0 && (sim_rng_faixa(&mon->rng_tick, 5) == 0)) e.bateria--;
+    int em_manobra = (e.status == STATUS_MANOBRA);
     
-    while (simulacao_rodando) {
-        pthread_mutex_lock(&mutex_estado);
+    if (em_manobra) {
+        if (sim_rng_faixa(&mon->rng_tick, 2) == 0) e.temperatura += 2; 
+    } else {
+        if (e.temperatura > 25) e.temperatura -= 2;
+    }
 
-        if (bateria > 0 && (rand() % 5 == 0)) bateria--;
-        int em_manobra = (strstr(status_sistema, "MANOBRA") != NULL);
-        
-        if (em_manobra) {
-            if (rand() % 2 == 0) temperatura += 2; 
-        } else {
-            if (temperatura > 25) temperatura -= 2;
+    mon->feito_ns = tempo_evento_ns; // junto com o sorteio, para o checkpoint
+    estado_publicar(&e);
+    if (downlink_ativo) downlink_publicar(&downlink, e.bateria, e.temperatura, e.status, DOWNLINK_ORIGEM_MONITOR);
+
+    // Monitoramento (fora do lock, sobre a cópia local)
+    if (em_manobra) {
+        sprintf(msg, "Monitorando propulsão... Temp:%dC", e.temperatura);
+        print_log_seguro(msg, id, 0); 
+    }
+    else if (e.temperatura > 80) {
+        sprintf(msg, "ALERTA: SUPERAQUECIMENTO (%d C)!", e.temperatura);
+        print_log_seguro(msg, id, 1);
+    } 
+    else if (e.bateria < 10) {
+        sprintf(msg, "ALERTA: BATERIA CRITICA (%d%%)!", e.bateria);
+        print_log_seguro(msg, id, 2);
+    }
+}
+
+void* thread_telemetria(void* arg) {
+    monitor_t *mon = (monitor_t *) arg;
+    // No roteiro o id é o índice, para a saída não depender do tid
+    long id = modo_script ? mon->indice + 1 : get_thread_id();
+    uint64_t ticks;
+    
+    // Bloqueia até o main sinalizar um tick; o mesmo eventfd acorda para sair
+    while (read(mon->evento_fd, &ticks, sizeof(ticks)) == sizeof(ticks) && simulacao_rodando) {
+        tempo_evento_ns = atomic_load(&mon->tick_ns);
+        unsigned long real = sim_agora_ns();
+        hist_registrar(&hist_tick_atraso, real > tempo_evento_ns ? real - tempo_evento_ns : 0);
+        if (mon->ultimo_real) {
+            long desvio = (long) (real - mon->ultimo_real) - (long) (tempo_evento_ns - mon->ultimo_previsto);
+            hist_registrar(&hist_tick_jitter, (unsigned long) (desvio < 0 ? -desvio : desvio));
         }
+        mon->ultimo_real = real;
+        mon->ultimo_previsto = tempo_evento_ns;
+        telemetria_tick(mon, id);
+    }
+    return NULL;
+}
+
+// Próximo tick de um monitor: 3 a 5 s depois do anterior, como o antigo usleep
+void agendar_tick_monitor(monitor_t *mon) {
+    long us = 3000000 + sim_rng_faixa(&mon->rng_timer, 2000000);
+    mon->proximo_ns += (unsigned long) us * 1000UL;
+}
+
+// Arma um timerfd para o instante 't' da simulação (absoluto, sem deriva)
+void armar_timer(int fd, unsigned long t) {
+    unsigned long alvo = sim_t0_ns + t;
+    struct itimerspec its = {0};
+    its.it_value.tv_sec = alvo / SIM_NS_POR_S;
+    its.it_value.tv_nsec = alvo % SIM_NS_POR_S;
+    timerfd_settime(fd, TFD_TIMER_ABSTIME, &its, NULL);
+}
+
+// --- EXECUTIVO (ESCALONADOR DE TAREFAS) ---
+// Como o Executive do AGC real: um número fixo de workers executa tarefas
+// com prioridade, em passos curtos. Um passo nunca dorme; ele devolve em
+// quantos ms quer rodar de novo e volta para a fila de timers. Quando vence,
+// a tarefa passa para a fila de prontas, ordenada por prioridade, então uma
+// manobra vencida sempre sai antes de um downlink vencido.
+// Se a fila está cheia, uma tarefa nova derruba a de menor prioridade (que
+// roda na hora o seu passo de limpeza, como num cancelamento); se não houver
+// nenhuma menos importante, é rejeitada (ALARME 1202).
+#define EXEC_WORKERS 2
+#define EXEC_FILA_MAX 32
+
+enum { PRIO_MANOBRA = 0, PRIO_DOWNLINK = 1 }; // menor = mais urgente
+
+typedef struct tarefa tarefa_t;
+struct tarefa {
+    int id;
+    int prioridade;
+    int etapa;              // estado interno do passo
+    int parametro;          // ex.: duração da manobra em s
+    int cancelada;          // o próximo passo é o de limpeza
+    unsigned long quando_ns; // instante em que o próximo passo deve rodar
+    unsigned long seq;      // desempate FIFO
+    const char *nome;
+    long (*passo)(tarefa_t *t); // ms até o próximo passo, ou -1 ao terminar
+};
+
+typedef struct {
+    tarefa_t itens[EXEC_FILA_MAX];
+    int n;
+    int (*antes)(const tarefa_t *a, const tarefa_t *b);
+} heap_tarefas_t;
+
+static int antes_por_tempo(const tarefa_t *a, const tarefa_t *b) {
+    if (a->quando_ns != b->quando_ns) return a->quando_ns < b->quando_ns;
+    if (a->prioridade != b->prioridade) return a->prioridade < b->prioridade;
+    return a->seq < b->seq;
+}
+
+static int antes_por_prioridade(const tarefa_t *a, const tarefa_t *b) {
+    if (a->prioridade != b->prioridade) return a->prioridade < b->prioridade;
+    if (a->quando_ns != b->quando_ns) return a->quando_ns < b->quando_ns;
+    return a->seq < b->seq;
+}
+
+static void heap_trocar(heap_tarefas_t *h, int i, int j) {
+    tarefa_t t = h->itens[i];
+    h->itens[i] = h->itens[j];
+    h->itens[j] = t;
+}
+
+static void heap_subir(heap_tarefas_t *h, int i) {
+    while (i > 0 && h->antes(&h->itens[i], &h->itens[(i - 1) / 2])) {
+        heap_trocar(h, i, (i - 1) / 2);
+        i = (i - 1) / 2;
+    }
+}
+
+static void heap_descer(heap_tarefas_t *h, int i) {
+    for (;;) {
+        int menor = i, e = 2 * i + 1, d = 2 * i + 2;
+        if (e < h->n && h->antes(&h->itens[e], &h->itens[menor])) menor = e;
+        if (d < h->n && h->antes(&h->itens[d], &h->itens[menor])) menor = d;
+        if (menor == i) return;
+        heap_trocar(h, i, menor);
+        i = menor;
+    }
+}
+
+static void heap_inserir(heap_tarefas_t *h, const tarefa_t *t) {
+    h->itens[h->n] = *t;
+    heap_subir(h, h->n++);
+}
+
+// Remove o item na posição i (0 = topo) e devolve uma cópia
+static tarefa_t heap_remover(heap_tarefas_t *h, int i) {
+    tarefa_t t = h->itens[i];
+    h->itens[i] = h->itens[--h->n];
+    if (i < h->n) {
+        heap_descer(h, i);
+        heap_subir(h, i);
+    }
+    return t;
+}
+
+struct {
+    pthread_mutex_t mutex;
+    pthread_cond_t cond;
+    pthread_cond_t ocioso;   // algum passo terminou (exec_aguardar_ate)
+    heap_tarefas_t timers;   // esperando o instante
+    heap_tarefas_t prontas;  // vencidas, por prioridade
+    int executando;
+    int rodando_id[EXEC_WORKERS];       // tarefa em cada worker (0 = livre)
+    int rodando_cancelar[EXEC_WORKERS]; // pedido de cancelamento durante o passo
+    unsigned long rodando_quando[EXEC_WORKERS];
+    int proximo_id;
+    unsigned long seq;
+    int encerrar;
+    int congelar;            // checkpoint copiando as filas: não comece passos
+    pthread_t workers[EXEC_WORKERS];
+    // métricas
+    int profundidade_max;
+    unsigned long submetidas, passos, rejeitadas, descartadas, canceladas;
+    unsigned long atraso_total_ns, atraso_max_ns;
+} exec = {
+    .mutex = PTHREAD_MUTEX_INITIALIZER,
+    .cond = PTHREAD_COND_INITIALIZER,
+    .ocioso = PTHREAD_COND_INITIALIZER,
+    .timers = { .antes = antes_por_tempo },
+    .prontas = { .antes = antes_por_prioridade },
+    .proximo_id = 1,
+};
 
-        // Monitoramento
-        if (em_manobra) {
-            sprintf(msg, "Monitorando propulsão... Temp:%dC", temperatura);
-            print_log_seguro(msg, id, 0); 
+// Chamar com exec.mutex
+static int exec_profundidade(void) {
+    return exec.timers.n + exec.prontas.n + exec.executando;
+}
+
+static void exec_enfileirar(tarefa_t *t) {
+    t->seq = exec.seq++;
+    heap_inserir(&exec.timers, t);
+    int p = exec_profundidade();
+    if (p > exec.profundidade_max) exec.profundidade_max = p;
+    pthread_cond_signal(&exec.cond);
+}
+
+// Com exec.mutex: move os timers vencidos para as prontas e executa a mais
+// urgente no worker 'w' (solta o mutex durante o passo). Devolve 1 se rodou.
+// Os horários são nominais: o próximo passo é marcado a partir do horário
+// previsto deste, não de quando o worker conseguiu rodá-lo.
+static int exec_rodar_pronta(int w) {
+    unsigned long agora = sim_agora_ns();
+    while (exec.timers.n > 0 && exec.timers.itens[0].quando_ns <= agora) {
+        tarefa_t t = heap_remover(&exec.timers, 0);
+        heap_inserir(&exec.prontas, &t);
+    }
+    if (exec.prontas.n == 0) return 0;
+
+    tarefa_t t = heap_remover(&exec.prontas, 0);
+    unsigned long atraso = agora - t.quando_ns;
+    exec.passos++;
+    exec.atraso_total_ns += atraso;
+    if (atraso > exec.atraso_max_ns) exec.atraso_max_ns = atraso;
+    exec.executando++;
+    exec.rodando_id[w] = t.id;
+    exec.rodando_cancelar[w] = 0;
+    exec.rodando_quando[w] = t.quando_ns;
+    pthread_mutex_unlock(&exec.mutex);
+
+    tempo_evento_ns = t.quando_ns;
+    long prox_ms = t.passo(&t);
+
+    pthread_mutex_lock(&exec.mutex);
+    exec.executando--;
+    exec.rodando_id[w] = 0;
+    if (prox_ms >= 0) {
+        if (exec.rodando_cancelar[w]) { // cancelada no meio do passo
+            t.cancelada = 1;
+            prox_ms = 0;
         }
-        else if (temperatura > 80) {
-            sprintf(msg, "ALERTA: SUPERAQUECIMENTO (%d C)!", temperatura);
-            print_log_seguro(msg, id, 1);
-        } 
-        else if (bateria < 10) {
-            sprintf(msg, "ALERTA: BATERIA CRITICA (%d%%)!", bateria);
-            print_log_seguro(msg, id, 2);
+        t.quando_ns += (unsigned long) prox_ms * 1000000UL;
+        exec_enfileirar(&t);
+    }
+    pthread_cond_broadcast(&exec.ocioso);
+    return 1;
+}
+
+void* thread_executivo(void* arg) {
+    int w = (int) (intptr_t) arg;
+    pthread_mutex_lock(&exec.mutex);
+    while (!exec.encerrar) {
+        if (exec.congelar) {
+            pthread_cond_wait(&exec.cond, &exec.mutex);
+            continue;
         }
+        if (exec_rodar_pronta(w)) continue;
 
-        pthread_mutex_unlock(&mutex_estado);
-        usleep(3000000 + (rand() % 2000000)); 
+        if (exec.timers.n > 0) {
+            unsigned long alvo = sim_t0_ns + exec.timers.itens[0].quando_ns;
+            struct timespec ts = { (time_t) (alvo / SIM_NS_POR_S), (long) (alvo % SIM_NS_POR_S) };
+            pthread_cond_timedwait(&exec.cond, &exec.mutex, &ts);
+        } else {
+            pthread_cond_wait(&exec.cond, &exec.mutex);
+        }
     }
+    pthread_mutex_unlock(&exec.mutex);
     return NULL;
 }
 
-//  THREAD DE MANOBRA 
-void* thread_manobra(void* arg) {
-    int duracao = *((int*)arg);
-    free(arg); 
+// Modo virtual: roda no chamador todos os passos vencidos até o instante atual
+void exec_rodar_vencidas(void) {
+    pthread_mutex_lock(&exec.mutex);
+    while (exec_rodar_pronta(0));
+    pthread_mutex_unlock(&exec.mutex);
+}
+
+// Instante do próximo passo agendado (ULONG_MAX se não há nenhum)
+unsigned long exec_proximo_ns(void) {
+    pthread_mutex_lock(&exec.mutex);
+    unsigned long t = exec.timers.n > 0 ? exec.timers.itens[0].quando_ns : ULONG_MAX;
+    pthread_mutex_unlock(&exec.mutex);
+    return t;
+}
+
+// Modo real com roteiro: espera os passos com horário <= t terminarem, para
+// um comando no mesmo instante de um passo ver o mesmo estado que no modo
+// virtual (lá os passos vencidos sempre rodam antes dos comandos).
+void exec_aguardar_ate(unsigned long t) {
+    pthread_mutex_lock(&exec.mutex);
+    for (;;) {
+        int pendente = exec.prontas.n > 0 ||
+                       (exec.timers.n > 0 && exec.timers.itens[0].quando_ns <= t);
+        for (int w = 0; w < EXEC_WORKERS && !pendente; w++)
+            pendente = exec.rodando_id[w] != 0 && exec.rodando_quando[w] <= t;
+        if (!pendente || exec.encerrar) break;
+        pthread_cond_wait(&exec.ocioso, &exec.mutex);
+    }
+    pthread_mutex_unlock(&exec.mutex);
+}
+
+// Agenda uma tarefa para já. Devolve o id, ou -1 se foi rejeitada.
+int exec_submeter(const char *nome, int prioridade, long (*passo)(tarefa_t *), int parametro) {
     char msg[100];
+    tarefa_t t = {0};
+    t.prioridade = prioridade;
+    t.parametro = parametro;
+    t.nome = nome;
+    t.passo = passo;
 
-    pthread_mutex_lock(&mutex_estado);
-    sprintf(status_sistema, "EXECUTANDO MANOBRA DE ORBITA (%ds)...", duracao);
-    sprintf(msg, "Propulsores principais ativados. Duração: %ds", duracao);
-    print_log_seguro(msg, 0, 3); 
-    pthread_mutex_unlock(&mutex_estado);
+    // Os avisos saem com o mutex seguro para ficarem antes do primeiro passo
+    pthread_mutex_lock(&exec.mutex);
+    exec.submetidas++;
+    if (exec_profundidade() >= EXEC_FILA_MAX) {
+        // Procura a tarefa enfileirada menos importante (e mais nova)
+        heap_tarefas_t *hv = NULL;
+        int iv = -1;
+        heap_tarefas_t *heaps[2] = { &exec.timers, &exec.prontas };
+        for (int h = 0; h < 2; h++) {
+            for (int i = 0; i < heaps[h]->n; i++) {
+                tarefa_t *c = &heaps[h]->itens[i];
+                if (c->prioridade <= prioridade || c->cancelada) continue;
+                if (iv < 0 || c->prioridade > hv->itens[iv].prioridade ||
+                    (c->prioridade == hv->itens[iv].prioridade && c->id > hv->itens[iv].id)) {
+                    hv = heaps[h];
+                    iv = i;
+                }
+            }
+        }
+        if (iv < 0) {
+            exec.rejeitadas++;
+            snprintf(msg, sizeof(msg), "ALARME 1202: executivo sobrecarregado, %s rejeitada.", nome);
+            print_log_seguro(msg, 0, 1);
+            pthread_mutex_unlock(&exec.mutex);
+            return -1;
+        }
+        tarefa_t v = heap_remover(hv, iv);
+        exec.descartadas++;
+        snprintf(msg, sizeof(msg), "ALARME 1202: tarefa #%d (%s) descartada por sobrecarga.", v.id, v.nome);
+        print_log_seguro(msg, 0, 1);
+        // Limpeza já, no lugar do passo que não vai rodar: registra o
+        // progresso e desfaz o que a tarefa tinha ligado
+        v.cancelada = 1;
+        v.passo(&v);
+    }
+    t.id = exec.proximo_id++;
+    t.quando_ns = tempo_evento_ns;
+    snprintf(msg, sizeof(msg), "Tarefa #%d (%s) agendada.", t.id, nome);
+    print_log_seguro(msg, 0, 3);
+    exec_enfileirar(&t);
+    pthread_mutex_unlock(&exec.mutex);
+    return t.id;
+}
 
-    sleep(duracao);
+// Cancela uma tarefa: o próximo passo dela roda já, com t->cancelada = 1
+int exec_cancelar(int id) {
+    int achou = 0;
+    pthread_mutex_lock(&exec.mutex);
+    heap_tarefas_t *heaps[2] = { &exec.timers, &exec.prontas };
+    for (int h = 0; h < 2 && !achou; h++) {
+        for (int i = 0; i < heaps[h]->n; i++) {
+            if (heaps[h]->itens[i].id != id || heaps[h]->itens[i].cancelada) continue;
+            tarefa_t t = heap_remover(heaps[h], i);
+            t.cancelada = 1;
+            t.quando_ns = tempo_evento_ns;
+            exec_enfileirar(&t);
+            achou = 1;
+            break;
+        }
+    }
+    for (int w = 0; w < EXEC_WORKERS && !achou; w++) {
+        if (exec.rodando_id[w] == id) {
+            exec.rodando_cancelar[w] = 1;
+            achou = 1;
+        }
+    }
+    if (achou) exec.canceladas++;
+    pthread_mutex_unlock(&exec.mutex);
+    return achou ? 0 : -1;
+}
 
-    pthread_mutex_lock(&mutex_estado);
-    strcpy(status_sistema, "PROPULSORES DESLIGADOS. ORBITA ESTAVEL.");
+int exec_iniciar(void) {
+    pthread_condattr_t attr;
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC); // mesmo relógio da simulação
+    pthread_cond_init(&exec.cond, &attr);
+    pthread_condattr_destroy(&attr);
+    for (int w = 0; w < EXEC_WORKERS; w++) {
+        if (pthread_create(&exec.workers[w], NULL, thread_executivo, (void *) (intptr_t) w) != 0) {
+            perror("exec_iniciar");
+            return -1;
+        }
+    }
+    return 0;
+}
+
+// Para os workers; tarefas ainda pendentes são abandonadas
+void exec_finalizar(void) {
+    pthread_mutex_lock(&exec.mutex);
+    exec.encerrar = 1;
+    pthread_cond_broadcast(&exec.cond);
+    pthread_cond_broadcast(&exec.ocioso);
+    pthread_mutex_unlock(&exec.mutex);
+    for (int w = 0; w < EXEC_WORKERS; w++) pthread_join(exec.workers[w], NULL);
+    pthread_cond_destroy(&exec.cond);
+}
+
+//  TAREFA DE MANOBRA 
+long passo_manobra(tarefa_t *t) {
+    char msg[100];
+    estado_t e;
+
+    if (t->cancelada) {
+        if (t->etapa == 1) { // propulsores já ligados: desliga
+            e = estado_travar();
+            e.status = STATUS_ORBITA_ESTAVEL;
+            estado_publicar(&e);
+        }
+        snprintf(msg, sizeof(msg), "Manobra #%d abortada.", t->id);
+        print_log_seguro(msg, 0, 3);
+        return -1;
+    }
+
+    if (t->etapa == 0) {
+        e = estado_travar();
+        e.status = STATUS_MANOBRA;
+        e.duracao_manobra = t->parametro;
+        estado_publicar(&e);
+        sprintf(msg, "Propulsores principais ativados. Duração: %ds", t->parametro);
+        print_log_seguro(msg, 0, 3); 
+        t->etapa = 1;
+        return t->parametro * 1000L;
+    }
+
+    e = estado_travar();
+    e.status = STATUS_ORBITA_ESTAVEL;
+    estado_publicar(&e);
     sprintf(msg, "Manobra de órbita finalizada com sucesso.");
     print_log_seguro(msg, 0, 3);
-    pthread_mutex_unlock(&mutex_estado);
-
-    return NULL;
+    return -1;
 }
 
-//  THREAD DOWNLINK 
-void* thread_downlink(void* arg) {
+//  TAREFA DOWNLINK 
+// etapa 0 anuncia; etapas 1..5 enviam 20% cada, a cada 2 s
+long passo_downlink(tarefa_t *t) {
     char msg[100];
-    
-    pthread_mutex_lock(&mutex_estado);
-    sprintf(msg, "Iniciando transmissão de dados para Houston...");
-    print_log_seguro(msg, 0, 4); 
-    pthread_mutex_unlock(&mutex_estado);
 
-    for(int i = 20; i <= 100; i += 20) {
-        sleep(2); 
-        pthread_mutex_lock(&mutex_estado);
-        if(bateria > 0) bateria--; 
-        sprintf(msg, "Enviando pacotes de telemetria... [%d%%]", i);
+    if (t->cancelada) {
+        // etapa k = já enviou k-1 pacotes de 20%
+        snprintf(msg, sizeof(msg), "Transmissão #%d interrompida em %d%%.", t->id,
+                 t->etapa > 1 ? (t->etapa - 1) * 20 : 0);
         print_log_seguro(msg, 0, 4);
-        pthread_mutex_unlock(&mutex_estado);
+        return -1;
     }
 
+    if (t->etapa == 0) {
+        sprintf(msg, "Iniciando transmissão de dados para Houston...");
+        print_log_seguro(msg, 0, 4); 
+        t->etapa = 1;
+        return 2000;
+    }
+
+    estado_t e = estado_travar();
+    if(e.bateria > 0) e.bateria--; 
+    estado_publicar(&e);
+    if (downlink_ativo) downlink_publicar(&downlink, e.bateria, e.temperatura, e.status, DOWNLINK_ORIGEM_RADIO);
+    sprintf(msg, "Enviando pacotes de telemetria... [%d%%]", t->etapa * 20);
+    print_log_seguro(msg, 0, 4);
+
+    if (t->etapa++ < 5) return 2000;
     sprintf(msg, "Transmissão de dados concluída.");
     print_log_seguro(msg, 0, 4);
-    return NULL;
+    return -1;
 }
 
 void imprimir_interface() {
-    pthread_mutex_lock(&mutex_estado); 
-    pthread_mutex_lock(&mutex_io);     
+    estado_t e = estado_ler();
+    char status[100];
+    texto_status(&e, status, sizeof(status));
+
+    pthread_mutex_lock(&exec.mutex);
+    int profundidade = exec_profundidade(), profundidade_max = exec.profundidade_max;
+    unsigned long rejeitadas = exec.rejeitadas;
+    pthread_mutex_unlock(&exec.mutex);
+
+    io_travar();     
     
     printf("\r\033[K");
     printf("-------------------------------------------------\n");
     printf("   AGC - SATELITE MULTITASK                      \n");
     printf("-------------------------------------------------\n");
-    printf(" BATERIA: %d%%  |  TEMP: %d C  |  STATUS: %s\n", bateria, temperatura, status_sistema);
+    printf(" BATERIA: %d%%  |  TEMP: %d C  |  STATUS: %s\n", e.bateria, e.temperatura, status);
+    printf(" EXECUTIVO: fila %d/%d  |  PICO: %d  |  REJEITADAS: %lu\n",
+           profundidade, EXEC_FILA_MAX, profundidade_max, rejeitadas);
     printf("-------------------------------------------------\n");
-    printf("COMANDOS: [ORBITA] [BAIXAR] [CARREGAR] [STATUS] [SAIR]\n");
+    printf("COMANDOS: [ORBITA] [BAIXAR] [CANCELAR n] [CARREGAR] [STATUS] [SAIR]\n");
     
     pthread_mutex_unlock(&mutex_io);     
-    pthread_mutex_unlock(&mutex_estado); 
 }
 
-int main() {
-    srand(time(NULL));
-    int qtd_threads;
+// Resposta imediata a um comando: no terminal sai na hora, no roteiro vai
+// para o log junto com o resto (e com o tempo de simulação)
+void avisar(int erro, const char *msg) {
+    if (modo_script) {
+        char linha[LOG_MSG_MAX];
+        snprintf(linha, sizeof(linha), "%s%s", erro ? "ERRO: " : "", msg);
+        print_log_seguro(linha, 0, erro ? 1 : 3);
+        return;
+    }
+    io_travar();
+    printf("\r\033[K%s %s\033[0m\n", erro ? "\033[1;31m[ERRO]" : "\033[1;34m[SISTEMA]", msg);
+    pthread_mutex_unlock(&mutex_io);
+}
 
-    printf("--- CONFIGURACAO DE SISTEMA ---\n");
-    printf("Quantas THREADS de monitoramento? ");
-    scanf("%d", &qtd_threads);
-    int trash; while ((trash = getchar()) != '\n' && trash != EOF);
-    if (qtd_threads < 1) qtd_threads = 1;
+// Executa um comando completo (digitado ou do roteiro)
+void processar_comando(const char *cmd) {
+    char msg[LOG_MSG_MAX];
+    ack_desde_ns = tempo_evento_ns;
 
-    enableRawMode(); 
+    if (strcmp(cmd, "ORBITA") == 0) {
+        exec_submeter("MANOBRA", PRIO_MANOBRA, passo_manobra, 30);
+    }
+    else if (strcmp(cmd, "BAIXAR") == 0) {
+        exec_submeter("DOWNLINK", PRIO_DOWNLINK, passo_downlink, 0);
+    }
+    else if (strncmp(cmd, "CANCELAR ", 9) == 0) {
+        int id = atoi(cmd + 9);
+        if (exec_cancelar(id) != 0) {
+            snprintf(msg, sizeof(msg), "Tarefa #%d nao encontrada.", id);
+            avisar(1, msg);
+        }
+    }
+    else if (strcmp(cmd, "CARREGAR") == 0) {
+        estado_t e = estado_travar();
+        e.bateria = 100;
+        e.status = STATUS_RECARREGADO;
+        estado_publicar(&e);
+        avisar(0, "Baterias recarregadas.");
+    }
+    else if (strcmp(cmd, "STATUS") == 0) {
+        if (modo_script) {
+            estado_t e = estado_ler();
+            char status[48];
+            texto_status(&e, status, sizeof(status));
+            snprintf(msg, sizeof(msg), "BATERIA: %d%% | TEMP: %d C | STATUS: %s", e.bateria, e.temperatura, status);
+            print_log_seguro(msg, 0, 3);
+        } else {
+            imprimir_interface(); 
+        }
+    }
+    else if (strcmp(cmd, "SAIR") == 0) {
+        simulacao_rodando = 0;
+    }
+    else {
+        avisar(1, "Comando desconhecido.");
+    }
 
-    printf("Iniciando %d thread(s)...\n", qtd_threads);
-    pthread_t* threads = malloc(sizeof(pthread_t) * qtd_threads);
-    for(int i = 0; i < qtd_threads; i++) {
-        pthread_create(&threads[i], NULL, thread_telemetria, NULL);
+    // Resposta impressa direto (ou nenhuma, como no SAIR): já está no terminal
+    if (ack_desde_ns != SEM_ACK) {
+        hist_registrar(&hist_comando, sim_agora_ns() - ack_desde_ns);
+        ack_desde_ns = SEM_ACK;
     }
+}
 
-    imprimir_interface();
-    pthread_mutex_lock(&mutex_io);
-    printf("COMANDO > ");
+// Trata uma tecla do terminal (modo raw). Chamado pelo laço de eventos.
+void processar_tecla(char c) {
+    io_travar(); 
+
+    if (c == '\n') { // ENTER
+        printf("\n"); 
+        input_buffer[input_pos] = '\0'; 
+        
+        pthread_mutex_unlock(&mutex_io);
+
+        // PROCESSAMENTO DE COMANDO
+        if (strlen(input_buffer) > 0) processar_comando(input_buffer);
+
+        io_travar();
+        memset(input_buffer, 0, sizeof(input_buffer));
+        input_pos = 0;
+        if (simulacao_rodando) printf("COMANDO > ");
+    
+    } else if (c == 127 || c == '\b') { // BACKSPACE
+        if (input_pos > 0) {
+            input_pos--;
+            input_buffer[input_pos] = '\0';
+            printf("\b \b"); 
+        }
+    } else if (!iscntrl(c) && input_pos < 255) { 
+        input_buffer[input_pos++] = c;
+        input_buffer[input_pos] = '\0';
+        printf("%c", c); 
+    }
+    
     fflush(stdout);
-    pthread_mutex_unlock(&mutex_io);
+    pthread_mutex_unlock(&mutex_io); 
+}
+
+// Lê o próximo comando do roteiro; no fim ou num erro de formato a simulação
+// acaba, e o erro fica anotado para o processo sair com status != 0
+void avancar_roteiro(sim_script_t *roteiro) {
+    int r = sim_script_avancar(roteiro);
+    if (r < 0) roteiro_erro = roteiro->linha;
+    if (r <= 0) simulacao_rodando = 0;
+}
+
+// Modo real com roteiro: executa os comandos cujo instante já passou, cada um
+// com o seu tempo nominal, e espera os passos que eles dispararam naquele
+// mesmo instante (no virtual, passos vencidos rodam antes dos monitores).
+void rodar_roteiro_vencido(sim_script_t *roteiro) {
+    while (simulacao_rodando && roteiro->tem && roteiro->tempo_ns <= sim_agora_ns()) {
+        unsigned long t = roteiro->tempo_ns;
+        exec_aguardar_ate(t);
+        tempo_evento_ns = t;
+        processar_comando(roteiro->comando);
+        avancar_roteiro(roteiro);
+        exec_aguardar_ate(t);
+    }
+}
+
+// --- CHECKPOINT ---
+// Retrato periódico do estado inteiro num arquivo mapeado em memória, para
+// recomeçar de onde parou (--restaurar) em milissegundos em vez de rodar a
+// simulação de novo desde T+0. Guarda o que torna o futuro determinístico:
+// o estado do satélite, as tarefas do executivo (com o instante do próximo
+// passo), os geradores e o próximo tick de cada monitor e a posição no
+// roteiro.
+//
+// O arquivo tem um cabeçalho e dois slots. Cada checkpoint grava o slot que
+// não é o último completo e só então publica a nova geração no cabeçalho,
+// então um processo morto no meio da gravação deixa o checkpoint anterior
+// intacto; a soma FNV-1a pega slots corrompidos. A gravação é uma cópia na
+// página mapeada mais um msync(MS_ASYNC): só as páginas sujas vão para o
+// disco, em segundo plano, e ninguém espera I/O.
+//
+// Ninguém para enquanto o arquivo é escrito. O retrato é montado antes, em
+// memória: com exec.mutex e exec.congelar nenhum passo começa (e os que estão
+// no meio terminam), e com mutex_estado nenhum monitor sorteia; os dois ficam
+// presos só pelo tempo de copiar alguns KB.
+#define CHECKPOINT_MAGICA 0x41474350u // "AGCP"
+#define CHECKPOINT_VERSAO 1
+#define CHECKPOINT_PAGINA 4096
+
+enum { CHECKPOINT_MANOBRA, CHECKPOINT_DOWNLINK };
+
+typedef struct {
+    uint32_t magica;
+    uint32_t versao;
+    uint32_t tam_slot;
+    uint32_t n_monitores;
+    _Atomic uint64_t geracao; // último checkpoint completo, no slot geracao % 2
+} checkpoint_cabecalho_t;
+
+typedef struct {
+    int32_t tipo;             // CHECKPOINT_MANOBRA / CHECKPOINT_DOWNLINK
+    int32_t id, prioridade, etapa, parametro, cancelada;
+    uint64_t quando_ns;       // próximo passo (tempo de simulação)
+    uint64_t seq;
+} checkpoint_tarefa_t;
+
+typedef struct {
+    uint64_t rng_tick, rng_timer;
+    uint64_t proximo_ns;
+    uint64_t pendente_ns;     // tick já sinalizado que a thread não processou
+} checkpoint_monitor_t;
+
+typedef struct {
+    uint64_t geracao;
+    uint64_t soma;            // FNV-1a de 'tempo_ns' até o último monitor
+    uint64_t tempo_ns;        // instante do retrato
+    int32_t bateria, temperatura, status, duracao_manobra;
+    int32_t proximo_id, n_tarefas;
+    uint64_t exec_seq;
+    checkpoint_tarefa_t tarefas[EXEC_FILA_MAX];
+    int64_t roteiro_pos;      // ftell depois do comando pendente (-1 = sem roteiro)
+    int32_t roteiro_linha, roteiro_tem;
+    uint64_t roteiro_tempo_ns;
+    char roteiro_comando[256];
+    uint32_t n_monitores, reservado;
+    checkpoint_monitor_t monitores[];
+} checkpoint_slot_t;
+
+struct {
+    int ativo;
+    unsigned long intervalo_ns;
+    unsigned long proximo_ns;
+    checkpoint_cabecalho_t *cab;
+    size_t tamanho, tam_slot;
+    checkpoint_slot_t *retrato; // montado sob os locks, gravado depois
+    // métricas
+    unsigned long gravados, pausa_total_ns, pausa_max_ns, gravacao_total_ns, gravacao_max_ns;
+} checkpoint = { .intervalo_ns = 60 * SIM_NS_POR_S };
+
+static size_t checkpoint_dados(int n_monitores) {
+    return sizeof(checkpoint_slot_t) + (size_t) n_monitores * sizeof(checkpoint_monitor_t);
+}
+
+static uint64_t checkpoint_soma(const checkpoint_slot_t *s) {
+    const unsigned char *p = (const unsigned char *) &s->tempo_ns;
+    const unsigned char *fim = (const unsigned char *) &s->monitores[s->n_monitores];
+    uint64_t h = 0xCBF29CE484222325ULL;
+    while (p < fim) h = (h ^ *p++) * 0x100000001B3ULL;
+    return h;
+}
+
+// Abre (ou cria) o arquivo para gravar. Um arquivo compatível é reaproveitado
+// e a numeração das gerações continua; senão começa vazio.
+int checkpoint_abrir(const char *caminho, int n_monitores) {
+    size_t tam_slot = (checkpoint_dados(n_monitores) + CHECKPOINT_PAGINA - 1) & ~(size_t) (CHECKPOINT_PAGINA - 1);
+    size_t tamanho = CHECKPOINT_PAGINA + 2 * tam_slot;
+    int fd = open(caminho, O_RDWR | O_CREAT, 0644);
+    if (fd < 0) return -1;
+    struct stat st;
+    int novo = fstat(fd, &st) != 0 || (size_t) st.st_size != tamanho;
+    if (novo && (ftruncate(fd, 0) != 0 || ftruncate(fd, (off_t) tamanho) != 0)) {
+        close(fd);
+        return -1;
+    }
+    void *p = mmap(NULL, tamanho, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (p == MAP_FAILED) return -1;
+
+    checkpoint_cabecalho_t *cab = (checkpoint_cabecalho_t *) p;
+    if (novo || cab->magica != CHECKPOINT_MAGICA || cab->versao != CHECKPOINT_VERSAO ||
+        cab->tam_slot != tam_slot || cab->n_monitores != (uint32_t) n_monitores) {
+        memset(p, 0, tamanho);
+        cab->versao = CHECKPOINT_VERSAO;
+        cab->tam_slot = (uint32_t) tam_slot;
+        cab->n_monitores = (uint32_t) n_monitores;
+        atomic_store(&cab->geracao, 0);
+        cab->magica = CHECKPOINT_MAGICA;
+    }
+    checkpoint.retrato = calloc(1, checkpoint_dados(n_monitores));
+    if (!checkpoint.retrato) {
+        munmap(p, tamanho);
+        return -1;
+    }
+    checkpoint.cab = cab;
+    checkpoint.tamanho = tamanho;
+    checkpoint.tam_slot = tam_slot;
+    checkpoint.ativo = 1;
+    return 0;
+}
+
+void checkpoint_fechar(void) {
+    if (!checkpoint.cab) return;
+    msync(checkpoint.cab, checkpoint.tamanho, MS_SYNC);
+    munmap(checkpoint.cab, checkpoint.tamanho);
+    free(checkpoint.retrato);
+    checkpoint.cab = NULL;
+    checkpoint.retrato = NULL;
+}
+
+// Monta o retrato e grava no slot livre. Chamado pelo laço de eventos, que é
+// dono do roteiro, dos geradores de intervalo e dos horários dos monitores.
+void checkpoint_gravar(monitor_t *monitores, int qtd, const sim_script_t *roteiro) {
+    checkpoint_slot_t *r = checkpoint.retrato;
+    unsigned long t0 = agora_ns();
+
+    // Espera os passos em andamento terminarem; novos não começam
+    pthread_mutex_lock(&exec.mutex);
+    exec.congelar = 1;
+    while (exec.executando > 0) pthread_cond_wait(&exec.ocioso, &exec.mutex);
+    pthread_mutex_lock(&mutex_estado); // nenhum monitor no meio de um tick
+
+    r->tempo_ns = sim_agora_ns();
+    estado_t e = estado_ler();
+    r->bateria = e.bateria;
+    r->temperatura = e.temperatura;
+    r->status = e.status;
+    r->duracao_manobra = e.duracao_manobra;
+    for (int i = 0; i < qtd; i++) {
+        monitor_t *mon = &monitores[i];
+        unsigned long tick = atomic_load(&mon->tick_ns);
+        r->monitores[i].rng_tick = mon->rng_tick.s;
+        r->monitores[i].rng_timer = mon->rng_timer.s;
+        r->monitores[i].proximo_ns = mon->proximo_ns;
+        // No virtual o tick roda dentro do laço, nunca fica pela metade
+        r->monitores[i].pendente_ns = !sim_virtual && tick != mon->feito_ns ? tick : SEM_TICK;
+    }
+    r->n_monitores = (uint32_t) qtd;
+    pthread_mutex_unlock(&mutex_estado);
+
+    r->n_tarefas = 0;
+    heap_tarefas_t *heaps[2] = { &exec.timers, &exec.prontas };
+    for (int h = 0; h < 2; h++) {
+        for (int i = 0; i < heaps[h]->n; i++) {
+            tarefa_t *t = &heaps[h]->itens[i];
+            r->tarefas[r->n_tarefas++] = (checkpoint_tarefa_t) {
+                t->passo == passo_manobra ? CHECKPOINT_MANOBRA : CHECKPOINT_DOWNLINK,
+                t->id, t->prioridade, t->etapa, t->parametro, t->cancelada, t->quando_ns, t->seq
+            };
+        }
+    }
+    r->proximo_id = exec.proximo_id;
+    r->exec_seq = exec.seq;
+    exec.congelar = 0;
+    pthread_cond_broadcast(&exec.cond);
+    pthread_mutex_unlock(&exec.mutex);
+    unsigned long t1 = agora_ns();
+
+    r->roteiro_pos = roteiro->f ? (int64_t) ftell(roteiro->f) : -1;
+    r->roteiro_linha = roteiro->linha;
+    r->roteiro_tem = roteiro->tem;
+    r->roteiro_tempo_ns = roteiro->tempo_ns;
+    memcpy(r->roteiro_comando, roteiro->comando, sizeof(r->roteiro_comando));
+
+    // Grava o slot que não é o último completo e só depois publica a geração
+    uint64_t geracao = atomic_load(&checkpoint.cab->geracao) + 1;
+    checkpoint_slot_t *slot = (checkpoint_slot_t *)
+        ((char *) checkpoint.cab + CHECKPOINT_PAGINA + (geracao % 2) * checkpoint.tam_slot);
+    r->geracao = geracao;
+    r->soma = checkpoint_soma(r);
+    memcpy(slot, r, checkpoint_dados(qtd));
+    msync(slot, checkpoint.tam_slot, MS_ASYNC);
+    atomic_store_explicit(&checkpoint.cab->geracao, geracao, memory_order_release);
+    unsigned long t2 = agora_ns();
+
+    checkpoint.gravados++;
+    checkpoint.pausa_total_ns += t1 - t0;
+    if (t1 - t0 > checkpoint.pausa_max_ns) checkpoint.pausa_max_ns = t1 - t0;
+    checkpoint.gravacao_total_ns += t2 - t0;
+    if (t2 - t0 > checkpoint.gravacao_max_ns) checkpoint.gravacao_max_ns = t2 - t0;
+}
+
+// Lê o último checkpoint completo (ou o anterior, se aquele não confere).
+// Devolve uma cópia em memória para liberar com free(), ou NULL.
+checkpoint_slot_t *checkpoint_ler(const char *caminho) {
+    int fd = open(caminho, O_RDONLY);
+    if (fd < 0) {
+        perror(caminho);
+        return NULL;
+    }
+    struct stat st;
+    void *p = MAP_FAILED;
+    if (fstat(fd, &st) == 0 && (size_t) st.st_size >= CHECKPOINT_PAGINA)
+        p = mmap(NULL, (size_t) st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (p == MAP_FAILED) {
+        fprintf(stderr, "%s: não é um checkpoint\n", caminho);
+        return NULL;
+    }
+
+    checkpoint_slot_t *copia = NULL;
+    const checkpoint_cabecalho_t *cab = (const checkpoint_cabecalho_t *) p;
+    if (cab->magica == CHECKPOINT_MAGICA && cab->versao == CHECKPOINT_VERSAO &&
+        (size_t) st.st_size == CHECKPOINT_PAGINA + 2 * (size_t) cab->tam_slot &&
+        checkpoint_dados((int) cab->n_monitores) <= cab->tam_slot) {
+        uint64_t g = atomic_load_explicit(&cab->geracao, memory_order_acquire);
+        for (uint64_t tentativa = g; tentativa > 0 && tentativa + 1 >= g && !copia; tentativa--) {
+            const checkpoint_slot_t *slot = (const checkpoint_slot_t *)
+                ((const char *) p + CHECKPOINT_PAGINA + (tentativa % 2) * cab->tam_slot);
+            if (slot->geracao != tentativa || slot->n_monitores != cab->n_monitores ||
+                slot->n_tarefas < 0 || slot->n_tarefas > EXEC_FILA_MAX || checkpoint_soma(slot) != slot->soma)
+                continue;
+            copia = malloc(checkpoint_dados((int) slot->n_monitores));
+            if (copia) memcpy(copia, slot, checkpoint_dados((int) slot->n_monitores));
+        }
+    }
+    munmap(p, (size_t) st.st_size);
+    if (!copia) fprintf(stderr, "%s: nenhum checkpoint válido\n", caminho);
+    return copia;
+}
+
+// Carrega o retrato antes de qualquer thread existir. Os horários guardados
+// são absolutos; o relógio recomeça em r->tempo_ns (sim_iniciar_em).
+void checkpoint_restaurar(const checkpoint_slot_t *r, monitor_t *monitores, sim_script_t *roteiro) {
+    atomic_store(&estado_bateria, r->bateria);
+    atomic_store(&estado_temperatura, r->temperatura);
+    atomic_store(&estado_status, r->status);
+    atomic_store(&estado_duracao, r->duracao_manobra);
+
+    for (uint32_t i = 0; i < r->n_monitores; i++) {
+        monitores[i].rng_tick.s = r->monitores[i].rng_tick;
+        monitores[i].rng_timer.s = r->monitores[i].rng_timer;
+        monitores[i].proximo_ns = r->monitores[i].proximo_ns;
+        monitores[i].pendente_ns = r->monitores[i].pendente_ns;
+    }
+
+    for (int i = 0; i < r->n_tarefas; i++) {
+        const checkpoint_tarefa_t *c = &r->tarefas[i];
+        int manobra = c->tipo == CHECKPOINT_MANOBRA;
+        tarefa_t t = {
+            .id = c->id, .prioridade = c->prioridade, .etapa = c->etapa, .parametro = c->parametro,
+            .cancelada = c->cancelada, .quando_ns = c->quando_ns, .seq = c->seq,
+            .nome = manobra ? "MANOBRA" : "DOWNLINK",
+            .passo = manobra ? passo_manobra : passo_downlink,
+        };
+        heap_inserir(&exec.timers, &t); // as vencidas passam para as prontas no primeiro passo
+    }
+    exec.proximo_id = r->proximo_id;
+    exec.seq = r->exec_seq;
+
+    // Mesmo roteiro: continua do comando que estava pendente
+    if (roteiro->f) {
+        if (r->roteiro_pos >= 0 && fseek(roteiro->f, (long) r->roteiro_pos, SEEK_SET) == 0) {
+            roteiro->linha = r->roteiro_linha;
+            roteiro->tem = r->roteiro_tem;
+            roteiro->tempo_ns = r->roteiro_tempo_ns;
+            memcpy(roteiro->comando, r->roteiro_comando, sizeof(roteiro->comando));
+        } else {
+            while (roteiro->tem && roteiro->tempo_ns <= r->tempo_ns)
+                avancar_roteiro(roteiro);
+        }
+        if (!roteiro->tem) simulacao_rodando = 0;
+    }
+}
+
+// --- MODO VIRTUAL ---
+// Simulação de eventos discretos numa thread só: a cada volta pega o evento
+// mais cedo entre o roteiro, os passos do executivo e os ticks dos monitores,
+// pula o relógio até ele e o executa. Empates no mesmo instante: passos do
+// executivo, depois o comando, depois os monitores (por ordem de agendamento).
+// O modo real com roteiro segue a mesma regra (ver exec_aguardar_ate). O
+// checkpoint vem por último, com tudo daquele instante já feito.
+enum { EVENTO_TICK, EVENTO_TICK_PENDENTE };
+
+void rodar_virtual(monitor_t *monitores, int qtd, sim_script_t *roteiro) {
+    sim_fila_t fila = {0};
+    for (int i = 0; i < qtd; i++) {
+        // Tick restaurado de um checkpoint do modo real: roda sem reagendar
+        if (monitores[i].pendente_ns != SEM_TICK)
+            sim_fila_inserir(&fila, monitores[i].pendente_ns, EVENTO_TICK_PENDENTE, i);
+        sim_fila_inserir(&fila, monitores[i].proximo_ns, EVENTO_TICK, i);
+    }
 
-    char c;
     while (simulacao_rodando) {
-        if (read(STDIN_FILENO, &c, 1) == 1) {
-            
-            pthread_mutex_lock(&mutex_io); 
-
-            if (c == '\n') { // ENTER
-                printf("\n"); 
-                input_buffer[input_pos] = '\0'; 
-                
-                pthread_mutex_unlock(&mutex_io);
-
-                // PROCESSAMENTO DE COMANDO
-                if (strlen(input_buffer) > 0) {
-                    
-                    if (strcmp(input_buffer, "ORBITA") == 0) {
-                        int* duracao = malloc(sizeof(int));
-                        *duracao = 30; 
-                        pthread_t t_manobra;
-                        pthread_create(&t_manobra, NULL, thread_manobra, duracao);
-                        pthread_detach(t_manobra); 
-                    }
-                    else if (strcmp(input_buffer, "BAIXAR") == 0) {
-                        pthread_t t_down;
-                        pthread_create(&t_down, NULL, thread_downlink, NULL);
-                        pthread_detach(t_down);
-                    }
-                    else if (strcmp(input_buffer, "CARREGAR") == 0) {
-                        pthread_mutex_lock(&mutex_estado);
-                        bateria = 100;
-                        sprintf(status_sistema, "SISTEMA RECARREGADO.");
-                        pthread_mutex_unlock(&mutex_estado);
-
-                        pthread_mutex_lock(&mutex_io);
-                        printf("\r\033[K\033[1;34m[SISTEMA] Baterias recarregadas.\033[0m\n");
-                        pthread_mutex_unlock(&mutex_io);
-                    }
-                    else if (strcmp(input_buffer, "STATUS") == 0) {
-                        imprimir_interface(); 
-                    }
-                    else if (strcmp(input_buffer, "SAIR") == 0) {
+        unsigned long t_cmd = roteiro->tem ? roteiro->tempo_ns : ULONG_MAX;
+        unsigned long t_tarefa = exec_proximo_ns();
+        unsigned long t_tick = fila.n > 0 ? fila.itens[0].tempo_ns : ULONG_MAX;
+        unsigned long t_cp = checkpoint.ativo ? checkpoint.proximo_ns : ULONG_MAX;
+
+        if (t_cp < t_tarefa && t_cp < t_cmd && t_cp < t_tick) {
+            sim_dormir_ate(t_cp);
+            checkpoint_gravar(monitores, qtd, roteiro);
+            checkpoint.proximo_ns += checkpoint.intervalo_ns;
+        } else if (t_tarefa <= t_cmd && t_tarefa <= t_tick && t_tarefa != ULONG_MAX) {
+            sim_dormir_ate(t_tarefa);
+            exec_rodar_vencidas();
+        } else if (t_cmd <= t_tick && t_cmd != ULONG_MAX) {
+            sim_dormir_ate(t_cmd);
+            tempo_evento_ns = t_cmd;
+            processar_comando(roteiro->comando);
+            avancar_roteiro(roteiro);
+        } else if (t_tick != ULONG_MAX) {
+            sim_evento_t ev = sim_fila_remover(&fila);
+            monitor_t *mon = &monitores[ev.indice];
+            sim_dormir_ate(ev.tempo_ns);
+            tempo_evento_ns = ev.tempo_ns;
+            telemetria_tick(mon, mon->indice + 1);
+            if (ev.tipo == EVENTO_TICK_PENDENTE) continue;
+            agendar_tick_monitor(mon);
+            sim_fila_inserir(&fila, mon->proximo_ns, EVENTO_TICK, ev.indice);
+        } else {
+            break;
+        }
+    }
+    sim_fila_liberar(&fila);
+}
+
+// --- BENCHMARK DO LOG ---
+typedef struct {
+    int assincrono;
+    int n_msgs;
+    unsigned long *lat; // latência de cada mensagem aceita, em ns
+    int aceitas;        // quantas posições de 'lat' valem
+} bench_log_arg_t;
+
+void* thread_bench_log(void* arg) {
+    bench_log_arg_t *b = (bench_log_arg_t *) arg;
+    long id = get_thread_id();
+    char msg[LOG_MSG_MAX];
+    b->aceitas = 0;
+    for (int i = 0; i < b->n_msgs; i++) {
+        snprintf(msg, sizeof(msg), "Mensagem de carga %d", i);
+        unsigned long t0 = agora_ns();
+        int aceita = 1;
+        if (b->assincrono) aceita = print_log_seguro(msg, id, 0);
+        else print_log_direto(msg, id, 0);
+        unsigned long dt = agora_ns() - t0;
+        // Descarte com anel cheio é só um CAS que falha: contá-lo puxaria
+        // os percentis para baixo, então ele entra só no total de descartes
+        if (aceita) b->lat[b->aceitas++] = dt;
+    }
+    return NULL;
+}
+
+static int cmp_ulong(const void *a, const void *b) {
+    unsigned long x = *(const unsigned long *) a, y = *(const unsigned long *) b;
+    return (x > y) - (x < y);
+}
+
+// Mede vazão (mensagens escritas/s) e latência de enfileirar nos dois caminhos;
+// no assíncrono os percentis são só das mensagens aceitas, com os descartes ao
+// lado. O log vai para stdout (redirecione para /dev/null); o relatório, para stderr.
+int bench_log(int produtores, int msgs) {
+    size_t total = (size_t) produtores * msgs;
+    unsigned long *lat = malloc(total * sizeof(unsigned long));
+    pthread_t *threads = malloc(produtores * sizeof(pthread_t));
+    bench_log_arg_t *args = malloc(produtores * sizeof(bench_log_arg_t));
+    if (!lat || !threads || !args) {
+        perror("malloc bench");
+        return 1;
+    }
+
+    for (int assincrono = 0; assincrono <= 1; assincrono++) {
+        if (assincrono && log_iniciar() != 0) return 1;
+        unsigned long t0 = agora_ns();
+        for (int i = 0; i < produtores; i++) {
+            args[i] = (bench_log_arg_t) { assincrono, msgs, lat + (size_t) i * msgs, 0 };
+            pthread_create(&threads[i], NULL, thread_bench_log, &args[i]);
+        }
+        for (int i = 0; i < produtores; i++) pthread_join(threads[i], NULL);
+        if (assincrono) log_finalizar(); // inclui o tempo de drenar o anel
+        double dt = (agora_ns() - t0) / 1e9;
+
+        // Junta as latências aceitas de cada produtor no começo de 'lat'
+        size_t aceitas = 0;
+        for (int i = 0; i < produtores; i++) {
+            memmove(lat + aceitas, args[i].lat, args[i].aceitas * sizeof(unsigned long));
+            aceitas += args[i].aceitas;
+        }
+        unsigned long escritas = assincrono ? atomic_load(&log_escritos) : total;
+        unsigned long p50 = 0, p99 = 0, max = 0;
+        if (aceitas > 0) {
+            qsort(lat, aceitas, sizeof(unsigned long), cmp_ulong);
+            p50 = lat[aceitas / 2];
+            p99 = lat[(size_t) (aceitas * 0.99)];
+            max = lat[aceitas - 1];
+        }
+        fprintf(stderr, "%-10s produtores %d; msgs %zu; escritas %lu; vazao %.0f msg/s; "
+                        "enfileirar (%zu aceitas) p50 %lu ns, p99 %lu ns, max %lu ns; descartadas %zu\n",
+                assincrono ? "assincrono" : "direto", produtores, total, escritas, escritas / dt,
+                aceitas, p50, p99, max, total - aceitas);
+    }
+    free(lat); free(threads); free(args);
+    return 0;
+}
+
+// --- BENCHMARK DO DOWNLINK ---
+// Produtores publicam quadros sem pausa; ./downlink_cons deve estar rodando
+// para esvaziar o anel (sem consumidor, tudo além da capacidade é descartado).
+typedef struct {
+    int n_quadros;
+    unsigned long publicados;
+    unsigned long *lat; // custo de cada publicação em ns
+} bench_downlink_arg_t;
+
+void* thread_bench_downlink(void* arg) {
+    bench_downlink_arg_t *b = (bench_downlink_arg_t *) arg;
+    for (int i = 0; i < b->n_quadros; i++) {
+        unsigned long t0 = agora_ns();
+        if (downlink_publicar(&downlink, 100 - i % 100, 25 + i % 60, i % 4, DOWNLINK_ORIGEM_RADIO) == 0)
+            b->publicados++;
+        b->lat[i] = agora_ns() - t0;
+    }
+    return NULL;
+}
+
+int bench_downlink(int produtores, int quadros) {
+    size_t total = (size_t) produtores * quadros;
+    unsigned long *lat = malloc(total * sizeof(unsigned long));
+    pthread_t *threads = malloc(produtores * sizeof(pthread_t));
+    bench_downlink_arg_t *args = calloc(produtores, sizeof(bench_downlink_arg_t));
+    if (!lat || !threads || !args) {
+        perror("malloc bench");
+        return 1;
+    }
+    if (downlink_abrir(&downlink, DOWNLINK_NOME_PADRAO, 1) != 0) {
+        perror("downlink " DOWNLINK_NOME_PADRAO);
+        return 1;
+    }
+
+    unsigned long t0 = agora_ns();
+    for (int i = 0; i < produtores; i++) {
+        args[i].n_quadros = quadros;
+        args[i].lat = lat + (size_t) i * quadros;
+        pthread_create(&threads[i], NULL, thread_bench_downlink, &args[i]);
+    }
+    unsigned long publicados = 0;
+    for (int i = 0; i < produtores; i++) {
+        pthread_join(threads[i], NULL);
+        publicados += args[i].publicados;
+    }
+    double dt = (agora_ns() - t0) / 1e9;
+
+    qsort(lat, total, sizeof(unsigned long), cmp_ulong);
+    fprintf(stderr, "downlink produtores %d; quadros %zu; publicados %lu; descartados %lu; "
+                    "vazao %.0f quadros/s; publicar p50 %lu ns, p99 %lu ns, max %lu ns\n",
+            produtores, total, publicados, (unsigned long) atomic_load(&downlink.cab->descartados),
+            publicados / dt, lat[total / 2], lat[(size_t) (total * 0.99)], lat[total - 1]);
+
+    // Dá tempo ao consumidor de drenar o anel antes de remover o nome
+    for (int i = 0; i < 50 && atomic_load(&downlink.cab->cabeca) < atomic_load(&downlink.cab->cauda); i++)
+        usleep(100000);
+    downlink_fechar(&downlink, DOWNLINK_NOME_PADRAO, 1);
+    free(lat); free(threads); free(args);
+    return 0;
+}
+
+// --- CONSTELAÇÃO ---
+// Teste de carga com N satélites. O estado fica em estrutura de vetores
+// (um vetor por campo), então um tick varre memória contígua. Um número fixo
+// de workers divide os satélites em faixas de 64 (nenhuma linha de cache é
+// dividida entre workers), cada um com o seu gerador, e todos se encontram
+// numa barreira no fim de cada tick. Em vez de log, os eventos são contados.
+#define CONST_ALINHAMENTO 64
+
+typedef struct {
+    int n;
+    int16_t *bateria;
+    int16_t *temperatura;
+    uint8_t *status;
+    uint8_t *restante; // ticks de manobra que faltam
+} constelacao_t;
+
+typedef struct {
+    constelacao_t *c;
+    int ini, fim;
+    int ticks;
+    pthread_barrier_t *inicio, *tick;
+    sim_rng_t rng;
+    unsigned long alertas, manobras, recargas;
+} worker_constelacao_t;
+
+// Cada worker num bloco de 64 bytes: os contadores não dividem linha de cache
+typedef union {
+    worker_constelacao_t w;
+    char pad[((sizeof(worker_constelacao_t) + CONST_ALINHAMENTO - 1) / CONST_ALINHAMENTO) * CONST_ALINHAMENTO];
+} worker_constelacao_slot_t;
+
+static void *alocar_alinhado(size_t bytes) {
+    return aligned_alloc(CONST_ALINHAMENTO, (bytes + CONST_ALINHAMENTO - 1) / CONST_ALINHAMENTO * CONST_ALINHAMENTO);
+}
+
+// Mesmas regras do tick de telemetria, mais o que o operador faria: manobras
+// ocasionais (~1/1024 por tick) e recarga quando a bateria fica crítica
+void constelacao_tick(worker_constelacao_t *w) {
+    constelacao_t *c = w->c;
+    for (int i = w->ini; i < w->fim; i++) {
+        uint64_t r = sim_rng_proximo(&w->rng); // um sorteio, vários bits
+        int b = c->bateria[i], t = c->temperatura[i], st = c->status[i];
+
+        if (b > 0 && (r & 0xFFFF) % 5 == 0) b--;
+        if (st == STATUS_MANOBRA) {
+            if ((r >> 16) & 1) t += 2;
+            if (--c->restante[i] == 0) st = STATUS_ORBITA_ESTAVEL;
+        } else {
+            if (t > 25) t -= 2;
+            if (((r >> 20) & 1023) == 0 && b > 20) {
+                st = STATUS_MANOBRA;
+                c->restante[i] = 8;
+                w->manobras++;
+            }
+        }
+        if (t > 80 || b < 10) w->alertas++;
+        if (b < 10 && st != STATUS_MANOBRA) {
+            b = 100;
+            st = STATUS_RECARREGADO;
+            w->recargas++;
+        }
+
+        c->bateria[i] = (int16_t) b;
+        c->temperatura[i] = (int16_t) t;
+        c->status[i] = (uint8_t) st;
+    }
+}
+
+void* thread_constelacao(void* arg) {
+    worker_constelacao_t *w = (worker_constelacao_t *) arg;
+    pthread_barrier_wait(w->inicio);
+    for (int k = 0; k < w->ticks; k++) {
+        constelacao_tick(w);
+        pthread_barrier_wait(w->tick);
+    }
+    return NULL;
+}
+
+// Roda 'ticks' ticks de 'n' satélites em 'workers' threads e imprime uma
+// linha CSV_DATA. ticks <= 0 escolhe um valor que dá ~50M satélite-ticks.
+int bench_constelacao(int n, int workers, int ticks, unsigned long semente) {
+    if (ticks <= 0) {
+        long alvo = 50000000L / n;
+        ticks = (int) (alvo < 20 ? 20 : alvo > 200000 ? 200000 : alvo);
+    }
+    // Não faz sentido mais workers que faixas de 64 satélites
+    int faixas = (n + CONST_ALINHAMENTO - 1) / CONST_ALINHAMENTO;
+    if (workers > faixas) workers = faixas;
+
+    constelacao_t c = { .n = n };
+    c.bateria = alocar_alinhado((size_t) n * sizeof(int16_t));
+    c.temperatura = alocar_alinhado((size_t) n * sizeof(int16_t));
+    c.status = alocar_alinhado((size_t) n);
+    c.restante = alocar_alinhado((size_t) n);
+    worker_constelacao_slot_t *slots = alocar_alinhado((size_t) workers * sizeof(worker_constelacao_slot_t));
+    pthread_t *threads = malloc((size_t) workers * sizeof(pthread_t));
+    if (!c.bateria || !c.temperatura || !c.status || !c.restante || !slots || !threads) {
+        perror("malloc constelacao");
+        return 1;
+    }
+    for (int i = 0; i < n; i++) {
+        c.bateria[i] = 100;
+        c.temperatura[i] = 25;
+        c.status[i] = STATUS_STANDBY;
+        c.restante[i] = 0;
+    }
+
+    pthread_barrier_t inicio, tick;
+    int rc = pthread_barrier_init(&inicio, NULL, workers + 1);
+    if (rc == 0 && (rc = pthread_barrier_init(&tick, NULL, workers)) != 0) pthread_barrier_destroy(&inicio);
+    if (rc != 0) {
+        fprintf(stderr, "pthread_barrier_init: %s\n", strerror(rc));
+        return 1;
+    }
+    int por_worker = (faixas + workers - 1) / workers * CONST_ALINHAMENTO;
+    for (int k = 0; k < workers; k++) {
+        worker_constelacao_t *w = &slots[k].w;
+        memset(&slots[k], 0, sizeof(slots[k]));
+        w->c = &c;
+        w->ini = k * por_worker < n ? k * por_worker : n;
+        w->fim = (k + 1) * por_worker < n ? (k + 1) * por_worker : n;
+        w->ticks = ticks;
+        w->inicio = &inicio;
+        w->tick = &tick;
+        sim_rng_semear(&w->rng, semente, (uint64_t) k);
+        rc = pthread_create(&threads[k], NULL, thread_constelacao, w);
+        if (rc != 0) {
+            // Os workers já criados estão presos na barreira de início, que
+            // conta com todos; só resta encerrar o processo
+            fprintf(stderr, "pthread_create (worker %d de %d): %s\n", k + 1, workers, strerror(rc));
+            return 1;
+        }
+    }
+
+    pthread_barrier_wait(&inicio);
+    unsigned long t0 = agora_ns();
+    for (int k = 0; k < workers; k++) pthread_join(threads[k], NULL);
+    double tp = (agora_ns() - t0) / 1e9;
+
+    unsigned long alertas = 0, manobras = 0, recargas = 0;
+    for (int k = 0; k < workers; k++) {
+        alertas += slots[k].w.alertas;
+        manobras += slots[k].w.manobras;
+        recargas += slots[k].w.recargas;
+    }
+    double soma_bateria = 0;
+    for (int i = 0; i < n; i++) soma_bateria += c.bateria[i];
+
+    char host[64] = "desconhecido";
+    gethostname(host, sizeof(host) - 1);
+    printf("CSV_DATA;computador: %s; satelites: %d; n_threads: %d; ticks: %d; semente: %lu; tp: %.6f; "
+           "ticks_s: %.1f; sat_ticks_s: %.0f; bateria_media: %.2f; manobras: %lu; alertas: %lu; recargas: %lu;\n",
+           host, n, workers, ticks, semente, tp, ticks / tp, (double) n * ticks / tp,
+           soma_bateria / n, manobras, alertas, recargas);
+
+    pthread_barrier_destroy(&inicio);
+    pthread_barrier_destroy(&tick);
+    free(c.bateria); free(c.temperatura); free(c.status); free(c.restante);
+    free(slots); free(threads);
+    return 0;
+}
+
+int main(int argc, char *argv[]) {
+    if (argc >= 4 && strcmp(argv[1], "--bench-log") == 0) {
+        int produtores = atoi(argv[2]), msgs = atoi(argv[3]);
+        if (produtores < 1 || msgs < 1) {
+            fprintf(stderr, "Uso: %s --bench-log <produtores> <mensagens_por_produtor>\n", argv[0]);
+            return 1;
+        }
+        return bench_log(produtores, msgs);
+    }
+    if (argc >= 4 && strcmp(argv[1], "--bench-downlink") == 0) {
+        int produtores = atoi(argv[2]), quadros = atoi(argv[3]);
+        if (produtores < 1 || quadros < 1) {
+            fprintf(stderr, "Uso: %s --bench-downlink <produtores> <quadros_por_produtor>\n", argv[0]);
+            return 1;
+        }
+        return bench_downlink(produtores, quadros);
+    }
+    if (argc >= 4 && strcmp(argv[1], "--constelacao") == 0) {
+        int satelites = atoi(argv[2]), workers = atoi(argv[3]);
+        int ticks = argc >= 5 ? atoi(argv[4]) : 0;
+        unsigned long semente = argc >= 6 ? strtoul(argv[5], NULL, 10) : 1;
+        if (satelites < 1 || workers < 1) {
+            fprintf(stderr, "Uso: %s --constelacao <satelites> <workers> [ticks (0 = automatico)] [semente]\n", argv[0]);
+            return 1;
+        }
+        return bench_constelacao(satelites, workers, ticks, semente);
+    }
+
+    unsigned long semente = (unsigned long) time(NULL);
+    int qtd_threads = 0, virtual_ = 0;
+    const char *caminho_roteiro = NULL, *caminho_checkpoint = NULL, *caminho_restaurar = NULL;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc) semente = strtoul(argv[++i], NULL, 10);
+        else if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc) qtd_threads = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--script") == 0 && i + 1 < argc) caminho_roteiro = argv[++i];
+        else if (strcmp(argv[i], "--virtual") == 0) virtual_ = 1;
+        else if (strcmp(argv[i], "--downlink") == 0) downlink_ativo = 1;
+        else if (strcmp(argv[i], "--checkpoint") == 0 && i + 1 < argc) caminho_checkpoint = argv[++i];
+        else if (strcmp(argv[i], "--intervalo") == 0 && i + 1 < argc)
+            checkpoint.intervalo_ns = (unsigned long) (atof(argv[++i]) * 1e9);
+        else if (strcmp(argv[i], "--restaurar") == 0 && i + 1 < argc) caminho_restaurar = argv[++i];
+        else {
+            fprintf(stderr, "Uso: %s [--seed N] [--threads N] [--script roteiro [--virtual]] [--downlink]\n"
+                            "       [--checkpoint arquivo [--intervalo s]] [--restaurar arquivo]\n", argv[0]);
+            return 1;
+        }
+    }
+    if (virtual_ && !caminho_roteiro) {
+        fprintf(stderr, "--virtual precisa de --script\n");
+        return 1;
+    }
+    if (checkpoint.intervalo_ns == 0) {
+        fprintf(stderr, "--intervalo precisa ser maior que zero\n");
+        return 1;
+    }
+
+    // O checkpoint decide quantos monitores existem
+    checkpoint_slot_t *restaurado = NULL;
+    unsigned long restauracao_inicio = agora_ns(), inicio_ns = 0;
+    if (caminho_restaurar) {
+        restaurado = checkpoint_ler(caminho_restaurar);
+        if (!restaurado) return 1;
+        if (qtd_threads > 0 && qtd_threads != (int) restaurado->n_monitores)
+            fprintf(stderr, "--threads ignorado: o checkpoint tem %u monitores\n", restaurado->n_monitores);
+        qtd_threads = (int) restaurado->n_monitores;
+        inicio_ns = restaurado->tempo_ns;
+    }
+
+    // SIGUSR1 vira evento do laço (signalfd); bloqueado antes de criar
+    // qualquer thread para que nenhuma delas o receba
+    sigset_t sinais;
+    sigemptyset(&sinais);
+    sigaddset(&sinais, SIGUSR1);
+    pthread_sigmask(SIG_BLOCK, &sinais, NULL);
+
+    if (downlink_ativo && downlink_abrir(&downlink, DOWNLINK_NOME_PADRAO, 1) != 0) {
+        perror("downlink " DOWNLINK_NOME_PADRAO);
+        return 1;
+    }
+
+    sim_script_t roteiro = {0};
+    if (caminho_roteiro) {
+        modo_script = 1;
+        if (sim_script_abrir(&roteiro, caminho_roteiro) != 0) return 1;
+        if (!roteiro.tem) simulacao_rodando = 0; // roteiro vazio
+        if (qtd_threads < 1) qtd_threads = 4;
+    } else if (qtd_threads < 1) {
+        printf("--- CONFIGURACAO DE SISTEMA ---\n");
+        printf("Quantas THREADS de monitoramento? ");
+        scanf("%d", &qtd_threads);
+        int trash; while ((trash = getchar()) != '\n' && trash != EOF);
+        if (qtd_threads < 1) qtd_threads = 1;
+    }
+
+    monitor_t* monitores = calloc(qtd_threads, sizeof(monitor_t));
+    for(int i = 0; i < qtd_threads; i++) {
+        monitores[i].indice = i;
+        sim_rng_semear(&monitores[i].rng_tick, semente, 2 * (uint64_t) i);
+        sim_rng_semear(&monitores[i].rng_timer, semente, 2 * (uint64_t) i + 1);
+        // O primeiro tick vem logo, como no laço antigo (tick antes do primeiro sleep)
+        monitores[i].proximo_ns = 0;
+        monitores[i].pendente_ns = SEM_TICK;
+        monitores[i].feito_ns = SEM_TICK;
+        atomic_init(&monitores[i].tick_ns, SEM_TICK);
+    }
+
+    unsigned long restauracao_ns = 0;
+    if (restaurado) {
+        checkpoint_restaurar(restaurado, monitores, &roteiro);
+        restauracao_ns = agora_ns() - restauracao_inicio;
+        tempo_evento_ns = inicio_ns;
+        char msg[LOG_MSG_MAX];
+        snprintf(msg, sizeof(msg), "Estado restaurado (geracao %lu): %d tarefa(s) pendente(s).",
+                 (unsigned long) restaurado->geracao, restaurado->n_tarefas);
+        print_log_seguro(msg, 0, 3);
+        for (int i = 0; i < restaurado->n_tarefas; i++) {
+            const checkpoint_tarefa_t *c = &restaurado->tarefas[i];
+            unsigned long falta = c->quando_ns > inicio_ns ? c->quando_ns - inicio_ns : 0;
+            snprintf(msg, sizeof(msg), "Tarefa #%d (%s) retomada na etapa %d; proximo passo em %.3f s.",
+                     c->id, c->tipo == CHECKPOINT_MANOBRA ? "MANOBRA" : "DOWNLINK", c->etapa, falta / 1e9);
+            print_log_seguro(msg, 0, 3);
+        }
+    }
+    if (caminho_checkpoint) {
+        if (checkpoint_abrir(caminho_checkpoint, qtd_threads) != 0) {
+            perror(caminho_checkpoint);
+            return 1;
+        }
+        checkpoint.proximo_ns = inicio_ns + checkpoint.intervalo_ns;
+    }
+
+    struct timespec t_inicio;
+    clock_gettime(CLOCK_MONOTONIC, &t_inicio);
+
+    if (virtual_) {
+        sim_iniciar_em(1, inicio_ns);
+        rodar_virtual(monitores, qtd_threads, &roteiro);
+    } else {
+        if (!modo_script) enableRawMode(); 
+        if (log_iniciar() != 0) return 1;
+        sim_iniciar_em(0, inicio_ns);
+        if (exec_iniciar() != 0) return 1;
+
+        if (!modo_script) printf("Iniciando %d thread(s)...\n", qtd_threads);
+        int epfd = epoll_create1(0);
+        if (epfd < 0) {
+            perror("epoll_create1");
+            return 1;
+        }
+        // data.ptr: NULL = teclado, &roteiro = próximo comando do roteiro,
+        // &sinais = SIGUSR1, &checkpoint = hora do checkpoint, senão o monitor
+        struct epoll_event ev = { .events = EPOLLIN, .data.ptr = &sinais };
+        int sinal_fd = signalfd(-1, &sinais, SFD_CLOEXEC);
+        epoll_ctl(epfd, EPOLL_CTL_ADD, sinal_fd, &ev);
+        ev.data.ptr = NULL;
+        int roteiro_fd = -1;
+        if (modo_script) {
+            roteiro_fd = timerfd_create(CLOCK_MONOTONIC, TFD_CLOEXEC);
+            ev.data.ptr = &roteiro;
+            epoll_ctl(epfd, EPOLL_CTL_ADD, roteiro_fd, &ev);
+        } else if (epoll_ctl(epfd, EPOLL_CTL_ADD, STDIN_FILENO, &ev) != 0) {
+            // EPERM: stdin é arquivo comum ou /dev/null, que o epoll não aceita;
+            // sem isso o laço esperaria para sempre por teclas que nunca chegam
+            perror("epoll stdin");
+            fprintf(stderr, "O modo interativo lê de um terminal ou pipe; para comandos "
+                            "de um arquivo use --script\n");
+            return 1;
+        }
+        int checkpoint_fd = -1;
+        if (checkpoint.ativo) {
+            checkpoint_fd = timerfd_create(CLOCK_MONOTONIC, TFD_CLOEXEC);
+            ev.data.ptr = &checkpoint;
+            epoll_ctl(epfd, EPOLL_CTL_ADD, checkpoint_fd, &ev);
+            armar_timer(checkpoint_fd, checkpoint.proximo_ns);
+        }
+
+        // Comandos do instante 0 vêm antes do primeiro tick, como no virtual
+        if (modo_script) rodar_roteiro_vencido(&roteiro);
+
+        for(int i = 0; i < qtd_threads; i++) {
+            monitores[i].timer_fd = timerfd_create(CLOCK_MONOTONIC, TFD_CLOEXEC);
+            monitores[i].evento_fd = eventfd(0, EFD_CLOEXEC);
+            if (monitores[i].timer_fd < 0 || monitores[i].evento_fd < 0) {
+                perror("timerfd/eventfd");
+                return 1;
+            }
+            ev.data.ptr = &monitores[i];
+            epoll_ctl(epfd, EPOLL_CTL_ADD, monitores[i].timer_fd, &ev);
+            pthread_create(&monitores[i].thread, NULL, thread_telemetria, &monitores[i]);
+            if (monitores[i].pendente_ns != SEM_TICK) { // sinalizado antes do checkpoint
+                atomic_store(&monitores[i].tick_ns, monitores[i].pendente_ns);
+                uint64_t um = 1;
+                if (write(monitores[i].evento_fd, &um, sizeof(um)) < 0) perror("telemetria eventfd");
+            }
+            // Um horário já passado (o primeiro tick, em T+0) vence na hora
+            armar_timer(monitores[i].timer_fd, monitores[i].proximo_ns);
+        }
+
+        if (modo_script) {
+            if (simulacao_rodando) armar_timer(roteiro_fd, roteiro.tempo_ns);
+        } else {
+            imprimir_interface();
+            io_travar();
+            printf("COMANDO > ");
+            fflush(stdout);
+            pthread_mutex_unlock(&mutex_io);
+        }
+
+        struct epoll_event eventos[16];
+        while (simulacao_rodando) {
+            int n = epoll_wait(epfd, eventos, 16, -1);
+            for (int e = 0; e < n && simulacao_rodando; e++) {
+                if (eventos[e].data.ptr == NULL) {
+                    char teclas[64];
+                    ssize_t lidos = read(STDIN_FILENO, teclas, sizeof(teclas));
+                    if (lidos <= 0) { // EOF no terminal: encerra como SAIR
                         simulacao_rodando = 0;
+                        break;
                     }
-                    else {
-                      
-                        pthread_mutex_lock(&mutex_io);
-                        printf("\r\033[K\033[1;31m[ERRO] Comando desconhecido.\033[0m\n");
-                        pthread_mutex_unlock(&mutex_io);
-                    }
-                }
-
-                pthread_mutex_lock(&mutex_io);
-                memset(input_buffer, 0, sizeof(input_buffer));
-                input_pos = 0;
-                if (simulacao_rodando) printf("COMANDO > ");
-            
-            } else if (c == 127 || c == '\b') { // BACKSPACE
-                if (input_pos > 0) {
-                    input_pos--;
-                    input_buffer[input_pos] = '\0';
-                    printf("\b \b"); 
+                    tempo_evento_ns = sim_agora_ns();
+                    for (ssize_t k = 0; k < lidos && simulacao_rodando; k++) processar_tecla(teclas[k]);
+                } else if (eventos[e].data.ptr == &sinais) {
+                    struct signalfd_siginfo info;
+                    if (read(sinal_fd, &info, sizeof(info)) != sizeof(info)) continue;
+                    io_travar();
+                    if (!modo_script) fprintf(stderr, "\r\033[K");
+                    despejar_histogramas(stderr);
+                    pthread_mutex_unlock(&mutex_io);
+                } else if (eventos[e].data.ptr == &roteiro) {
+                    uint64_t expirou;
+                    if (read(roteiro_fd, &expirou, sizeof(expirou)) != sizeof(expirou)) continue;
+                    rodar_roteiro_vencido(&roteiro);
+                    if (simulacao_rodando) armar_timer(roteiro_fd, roteiro.tempo_ns);
+                } else if (eventos[e].data.ptr == &checkpoint) {
+                    uint64_t expirou;
+                    if (read(checkpoint_fd, &expirou, sizeof(expirou)) != sizeof(expirou)) continue;
+                    checkpoint_gravar(monitores, qtd_threads, &roteiro);
+                    checkpoint.proximo_ns += checkpoint.intervalo_ns;
+                    armar_timer(checkpoint_fd, checkpoint.proximo_ns);
+                } else {
+                    // Timer de um monitor venceu: avisa a thread e agenda o próximo
+                    monitor_t *mon = (monitor_t *) eventos[e].data.ptr;
+                    uint64_t expirou, um = 1;
+                    if (read(mon->timer_fd, &expirou, sizeof(expirou)) != sizeof(expirou)) continue;
+                    atomic_store(&mon->tick_ns, mon->proximo_ns);
+                    if (write(mon->evento_fd, &um, sizeof(um)) < 0) perror("telemetria eventfd");
+                    agendar_tick_monitor(mon);
+                    armar_timer(mon->timer_fd, mon->proximo_ns);
                 }
-            } else if (!iscntrl(c) && input_pos < 255) { 
-                input_buffer[input_pos++] = c;
-                input_buffer[input_pos] = '\0';
-                printf("%c", c); 
             }
-            
-            fflush(stdout);
-            pthread_mutex_unlock(&mutex_io); 
         }
-        usleep(1000); 
+
+        // Acorda as threads de telemetria para verem simulacao_rodando == 0
+        for(int i = 0; i < qtd_threads; i++) {
+            uint64_t um = 1;
+            if (write(monitores[i].evento_fd, &um, sizeof(um)) < 0) perror("telemetria eventfd");
+        }
+        for(int i = 0; i < qtd_threads; i++) {
+            pthread_join(monitores[i].thread, NULL);
+            close(monitores[i].timer_fd);
+            close(monitores[i].evento_fd);
+        }
+        if (roteiro_fd >= 0) close(roteiro_fd);
+        if (checkpoint_fd >= 0) close(checkpoint_fd);
+        close(sinal_fd);
+        close(epfd);
+        exec_finalizar();
+    }
+
+    if (modo_script) {
+        // Estado final, no instante do último comando
+        estado_t e = estado_ler();
+        char status[48], msg[LOG_MSG_MAX];
+        texto_status(&e, status, sizeof(status));
+        snprintf(msg, sizeof(msg), "FIM: BATERIA %d%% | TEMP %d C | %s", e.bateria, e.temperatura, status);
+        print_log_seguro(msg, 0, 3);
+        sim_script_fechar(&roteiro);
+    }
+    if (!virtual_) log_finalizar();
+    fflush(stdout);
+
+    // CPU gasta pelo processo inteiro desde o início do laço
+    struct timespec t_fim;
+    struct rusage uso;
+    clock_gettime(CLOCK_MONOTONIC, &t_fim);
+    getrusage(RUSAGE_SELF, &uso);
+    double parede = (t_fim.tv_sec - t_inicio.tv_sec) + (t_fim.tv_nsec - t_inicio.tv_nsec) / 1e9;
+    double cpu = uso.ru_utime.tv_sec + uso.ru_utime.tv_usec / 1e6 + uso.ru_stime.tv_sec + uso.ru_stime.tv_usec / 1e6;
+    if (!virtual_) // no virtual a parede é curta demais para a razão fazer sentido
+        printf("%s[METRICAS] CPU %.3f s em %.1f s (%.2f%%)\n", modo_script ? "" : "\r\033[K", cpu, parede, parede > 0 ? 100.0 * cpu / parede : 0.0);
+    if (modo_script) {
+        double simulado = tempo_evento_ns / 1e9;
+        printf("[METRICAS] simulado %.1f s em %.3f s de parede (%.0fx)\n",
+               simulado, parede, parede > 0 ? simulado / parede : 0.0);
+    }
+    printf("[METRICAS] log: %lu enfileiradas, %lu escritas, %lu descartadas (anel cheio)\n",
+           atomic_load(&log_enfileirados), atomic_load(&log_escritos), atomic_load(&log_descartados));
+    printf("[METRICAS] executivo: %lu submetidas, %lu passos, %lu rejeitadas, %lu descartadas, %lu canceladas; "
+           "fila max %d; atraso de escalonamento medio %.1f us, max %.1f us\n",
+           exec.submetidas, exec.passos, exec.rejeitadas, exec.descartadas, exec.canceladas,
+           exec.profundidade_max, exec.passos ? exec.atraso_total_ns / 1e3 / exec.passos : 0.0,
+           exec.atraso_max_ns / 1e3);
+    if (downlink_ativo) {
+        printf("[METRICAS] downlink: %lu quadros publicados, %lu descartados (anel cheio), %lu lidos\n",
+               (unsigned long) atomic_load(&downlink.cab->publicados),
+               (unsigned long) atomic_load(&downlink.cab->descartados),
+               (unsigned long) atomic_load(&downlink.cab->cabeca));
+        downlink_fechar(&downlink, DOWNLINK_NOME_PADRAO, 1);
+    }
+    if (restaurado) {
+        printf("[METRICAS] restauracao: %s (geracao %lu, T+%.3f s) em %.3f ms\n", caminho_restaurar,
+               (unsigned long) restaurado->geracao, restaurado->tempo_ns / 1e9, restauracao_ns / 1e6);
+        free(restaurado);
     }
+    if (checkpoint.ativo) {
+        unsigned long n = checkpoint.gravados;
+        printf("[METRICAS] checkpoint: %lu gravados em %s (%zu bytes cada); "
+               "pausa media %.1f us, max %.1f us; total media %.1f us, max %.1f us\n",
+               n, caminho_checkpoint, checkpoint_dados(qtd_threads),
+               n ? checkpoint.pausa_total_ns / 1e3 / n : 0.0, checkpoint.pausa_max_ns / 1e3,
+               n ? checkpoint.gravacao_total_ns / 1e3 / n : 0.0, checkpoint.gravacao_max_ns / 1e3);
+        checkpoint_fechar();
+    }
+    unsigned long secoes = atomic_load(&lock_secoes);
+    if (secoes > 0) {
+        printf("[METRICAS] mutex_estado: %lu secoes; posse media %.0f ns, max %lu ns; espera media %.0f ns\n",
+               secoes, (double) atomic_load(&lock_posse_total) / secoes, atomic_load(&lock_posse_max),
+               (double) atomic_load(&lock_espera_total) / secoes);
+    }
+    despejar_histogramas(stdout);
 
-    free(threads);
+    free(monitores);
     pthread_mutex_destroy(&mutex_estado);
     pthread_mutex_destroy(&mutex_io);
+    if (roteiro_erro) {
+        fprintf(stderr, "roteiro:%d: simulação interrompida por erro de formato\n", roteiro_erro);
+        return 1;
+    }
+    return 0;
 }
@@ -1,18 +1,79 @@
-
+// gcc -Wall -Wextra -O2 agc_simulator_sequencial.c -o agc_seq
+// ./agc_seq
+// ./agc_seq --script roteiro.txt [--virtual]
+//   Sem terminal: executa os comandos do roteiro (ver simulacao.h). Comando
+//   que chega com o sistema ocupado espera a ação atual terminar, como no
+//   modo interativo. Com --virtual o tempo é simulado e a saída "[T+...]" é
+//   a mesma do relógio real.
+// kill -USR1 <pid>   (imprime os histogramas de latência em stderr; também saem no fim)
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <unistd.h> 
 #include <time.h>
+#include <errno.h>
+#include <signal.h>
+#include "simulacao.h"
+#include "histograma.h"
 
 // --- ESTADO DO SATÉLITE ---
 int bateria = 100;
 int temperatura = 25;
 char status_sistema[100] = "EM ORBITA (STANDBY)";
 int simulacao_rodando = 1;
+int modo_script = 0;
+
+// Relógio nominal (ns de simulação): cada segundo de atividade soma
+// exatamente 1 s, então o relógio real não acumula a deriva dos sleeps.
+unsigned long relogio_ns = 0;
+
+// --- HISTOGRAMAS DE LATÊNCIA (ns) ---
+// Os mesmos nomes do simulador paralelo, para comparar lado a lado:
+// tick_atraso/tick_jitter medem o "tick" de 1 s de passar_tempo e
+// comando_ack vai do instante do comando no roteiro até ele começar a ser
+// atendido (aqui, todo o tempo em que o programa estava ocupado com outra ação).
+histograma_t hist_tick_atraso = HISTOGRAMA_INICIAL("tick_atraso");
+histograma_t hist_tick_jitter = HISTOGRAMA_INICIAL("tick_jitter");
+histograma_t hist_comando = HISTOGRAMA_INICIAL("comando_ack");
+volatile sig_atomic_t despejo_pedido = 0;
+unsigned long tick_ultimo_real = 0, tick_ultimo_previsto = 0;
+
+void despejar_histogramas(FILE *f) {
+    hist_imprimir(f, &hist_tick_atraso);
+    hist_imprimir(f, &hist_tick_jitter);
+    hist_imprimir(f, &hist_comando);
+}
+
+void ao_sigusr1(int sig) {
+    (void) sig;
+    despejo_pedido = 1;
+}
+
+// SIGUSR1 só marca; o despejo sai no próximo ponto seguro
+void atender_despejo() {
+    if (!despejo_pedido) return;
+    despejo_pedido = 0;
+    fflush(stdout);
+    despejar_histogramas(stderr);
+}
+
+// Substitui o sleep(): no modo virtual só avança o relógio
+void esperar(int segundos) {
+    if (!modo_script && sim_agora_ns() > relogio_ns) relogio_ns = sim_agora_ns(); // tempo parado no fgets
+    relogio_ns += (unsigned long) segundos * SIM_NS_POR_S;
+    sim_dormir_ate(relogio_ns);
+    atender_despejo();
+}
+
+// Uma linha de log: colorida no terminal, texto puro com o tempo no roteiro
+void registrar(const char *cor, const char *msg) {
+    if (modo_script) printf("[T+%12.3f] %s\n", relogio_ns / 1e9, msg);
+    else printf("%s%s\033[0m\n", cor, msg);
+}
 
 // Função para limpar o lixo que você digitou enquanto o programa estava travado
 void limpar_buffer_teclado() {
+    if (modo_script) return; // os comandos do roteiro não são lixo
     // Tenta ler tudo o que está pendente no stdin e joga fora
     // (Nota: Em C padrão é difícil limpar stdin de forma portável, 
     // mas fseek ou loops de getchar funcionam em muitos casos interativos simples)
@@ -22,7 +83,17 @@ void limpar_buffer_teclado() {
 // --- FUNÇÃO DE SIMULAÇÃO DE TEMPO ---
 void passar_tempo(int segundos, char* atividade) {
     for(int i = 1; i <= segundos; i++) {
-        sleep(1); // TRAVA O PROGRAMA
+        esperar(1); // TRAVA O PROGRAMA
+        if (!sim_virtual) { // no virtual o relógio é exato
+            unsigned long real = sim_agora_ns();
+            hist_registrar(&hist_tick_atraso, real > relogio_ns ? real - relogio_ns : 0);
+            if (tick_ultimo_real && relogio_ns - tick_ultimo_previsto == SIM_NS_POR_S) {
+                long desvio = (long) (real - tick_ultimo_real) - (long) SIM_NS_POR_S;
+                hist_registrar(&hist_tick_jitter, (unsigned long) (desvio < 0 ? -desvio : desvio));
+            }
+            tick_ultimo_real = real;
+            tick_ultimo_previsto = relogio_ns;
+        }
         
         if (bateria > 0) bateria--;
         
@@ -33,34 +104,41 @@ void passar_tempo(int segundos, char* atividade) {
         }
 
         // Feedback visual para mostrar que está vivo, mas ocupado
-        printf("\r\033[K"); 
-        printf("[SEQUENCIAL] Processando %s... (%ds/%ds) Temp:%dC Bat:%d%%", atividade, i, segundos, temperatura, bateria);
-        fflush(stdout);
+        char msg[150];
+        sprintf(msg, "[SEQUENCIAL] Processando %s... (%ds/%ds) Temp:%dC Bat:%d%%", atividade, i, segundos, temperatura, bateria);
+        if (modo_script) {
+            registrar("", msg);
+        } else {
+            printf("\r\033[K%s", msg); 
+            fflush(stdout);
+        }
 
         // Se a bateria morrer NO MEIO da ação, interrompe forçado
         if (bateria <= 0) {
-            printf("\n\n\033[1;31m[FALHA DE SISTEMA] BATERIA ESGOTADA DURANTE OPERACAO!\033[0m\n");
+            if (!modo_script) printf("\n\n");
+            registrar("\033[1;31m", "[FALHA DE SISTEMA] BATERIA ESGOTADA DURANTE OPERACAO!");
             strcpy(status_sistema, "SISTEMA DESLIGADO (SEM ENERGIA)");
             return; 
         }
     }
-    printf("\n");
+    if (!modo_script) printf("\n");
 }
 
 // --- AÇÕES ---
 void executar_manobra(int duracao) {
+    if (!modo_script) printf("\n");
     if (bateria <= 0) {
-        printf("\n\033[1;31m[ERRO] Sem energia para manobras.\033[0m\n");
+        registrar("\033[1;31m", "[ERRO] Sem energia para manobras.");
         return;
     }
     sprintf(status_sistema, "EXECUTANDO MANOBRA (%ds)", duracao);
-    printf("\n\033[1;34m[SISTEMA] Iniciando propulsores.\033[0m\n");
+    registrar("\033[1;34m", "[SISTEMA] Iniciando propulsores.");
     
     passar_tempo(duracao, "MANOBRA"); 
 
     if (bateria > 0) {
         strcpy(status_sistema, "ORBITA ESTAVEL");
-        printf("\033[1;34m[SISTEMA] Manobra finalizada.\033[0m\n");
+        registrar("\033[1;34m", "[SISTEMA] Manobra finalizada.");
     }
     
     // TRUQUE: Joga fora tudo o que você digitou enquanto esperava
@@ -68,25 +146,35 @@ void executar_manobra(int duracao) {
 }
 
 void executar_downlink() {
+    if (!modo_script) printf("\n");
     if (bateria <= 0) {
-        printf("\n\033[1;31m[ERRO] Sem energia para rádio.\033[0m\n");
+        registrar("\033[1;31m", "[ERRO] Sem energia para rádio.");
         return;
     }
-    printf("\n\033[1;35m[RADIO] Iniciando transmissão...\033[0m\n");
+    registrar("\033[1;35m", "[RADIO] Iniciando transmissão...");
     
     for(int i = 20; i <= 100; i += 20) {
         if (bateria <= 0) break; // Aborta se bateria morrer
         passar_tempo(2, "TRANSMISSAO");
-        printf("\033[1;35m[RADIO] Pacote enviado: %d%%\033[0m\n", i);
+        char msg[50];
+        sprintf(msg, "[RADIO] Pacote enviado: %d%%", i);
+        registrar("\033[1;35m", msg);
     }
     
-    if (bateria > 0) printf("\033[1;35m[RADIO] Download concluído.\033[0m\n");
-    else printf("\033[1;31m[RADIO] Transmissão falhou (Bateria Morta).\033[0m\n");
+    if (bateria > 0) registrar("\033[1;35m", "[RADIO] Download concluído.");
+    else registrar("\033[1;31m", "[RADIO] Transmissão falhou (Bateria Morta).");
 
     limpar_buffer_teclado();
 }
 
 void imprimir_interface() {
+    if (modo_script) { // uma linha só, no tempo de simulação
+        char msg[200];
+        sprintf(msg, "BATERIA: %d%% | TEMP: %d C | STATUS: %s", bateria, temperatura,
+                bateria <= 0 ? "MORTO" : status_sistema);
+        registrar("", msg);
+        return;
+    }
     printf("-------------------------------------------------\n");
     printf("   AGC - VERSAO SEQUENCIAL                       \n");
     printf("-------------------------------------------------\n");
@@ -100,51 +188,120 @@ void imprimir_interface() {
     printf("-------------------------------------------------\n");
 }
 
-int main() {
-    char comando[50];
+int main(int argc, char *argv[]) {
+    char comando[256];
     int duracao_manobra = 15; 
+    const char *caminho_roteiro = NULL;
+    int virtual_ = 0;
+    sim_script_t roteiro = {0};
+    int executou = 0;     // o comando carregado do roteiro já rodou
+    int roteiro_erro = 0; // linha do roteiro com erro de formato (0 = nenhuma)
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--script") == 0 && i + 1 < argc) caminho_roteiro = argv[++i];
+        else if (strcmp(argv[i], "--virtual") == 0) virtual_ = 1;
+        else {
+            fprintf(stderr, "Uso: %s [--script roteiro [--virtual]]\n", argv[0]);
+            return 1;
+        }
+    }
+    if (virtual_ && !caminho_roteiro) {
+        fprintf(stderr, "--virtual precisa de --script\n");
+        return 1;
+    }
+    if (caminho_roteiro) {
+        modo_script = 1;
+        if (sim_script_abrir(&roteiro, caminho_roteiro) != 0) return 1;
+    }
+    sim_iniciar(virtual_);
+
+    struct sigaction sa = {0};
+    sa.sa_handler = ao_sigusr1; // sem SA_RESTART: o fgets volta com EINTR
+    sigaction(SIGUSR1, &sa, NULL);
 
-    printf("Iniciando Sistema...\n");
+    if (!modo_script) printf("Iniciando Sistema...\n");
 
     while (simulacao_rodando) {
-        imprimir_interface();
-        printf("COMANDOS: [ORBITA] [BAIXAR] [CARREGAR] [STATUS] [SAIR]\n");
-        printf("COMANDO > ");
-        
-        if (fgets(comando, sizeof(comando), stdin) != NULL) {
+        if (modo_script) {
+            // Só lê o próximo depois de executar o atual: um erro de formato
+            // mais adiante não pode engolir um comando válido já lido
+            if (executou && sim_script_avancar(&roteiro) < 0) {
+                roteiro_erro = roteiro.linha;
+                break;
+            }
+            if (!roteiro.tem) break; // fim do roteiro
+            executou = 1;
+            // Se o sistema estava ocupado, o comando atrasado roda agora
+            if (roteiro.tempo_ns > relogio_ns) relogio_ns = roteiro.tempo_ns;
+            sim_dormir_ate(relogio_ns);
+            unsigned long inicio = sim_virtual ? relogio_ns : sim_agora_ns();
+            hist_registrar(&hist_comando, inicio - roteiro.tempo_ns);
+            snprintf(comando, sizeof(comando), "%s", roteiro.comando);
+        } else {
+            imprimir_interface();
+            printf("COMANDOS: [ORBITA] [BAIXAR] [CARREGAR] [STATUS] [SAIR]\n");
+            printf("COMANDO > ");
+            if (fgets(comando, sizeof(comando), stdin) == NULL) {
+                if (errno == EINTR && despejo_pedido) { // SIGUSR1 no meio da leitura
+                    clearerr(stdin);
+                    errno = 0;
+                    printf("\n");
+                    atender_despejo();
+                    continue;
+                }
+                break;
+            }
             comando[strcspn(comando, "\n")] = 0; 
+            atender_despejo();
+        }
 
-            // VERIFICAÇÃO DE ENERGIA ANTES DE QUALQUER COISA
-            if (bateria <= 0 && strcmp(comando, "CARREGAR") != 0 && strcmp(comando, "SAIR") != 0) {
-                printf("\n\033[1;31m[ERRO CRITICO] SISTEMA SEM ENERGIA. RECARREGUE IMEDIATAMENTE.\033[0m\n");
-                sleep(2); // Pequena pausa pra ler o erro
-                continue; // Pula pro próximo loop, ignora o comando
-            }
+        // VERIFICAÇÃO DE ENERGIA ANTES DE QUALQUER COISA
+        if (bateria <= 0 && strcmp(comando, "CARREGAR") != 0 && strcmp(comando, "SAIR") != 0) {
+            if (!modo_script) printf("\n");
+            registrar("\033[1;31m", "[ERRO CRITICO] SISTEMA SEM ENERGIA. RECARREGUE IMEDIATAMENTE.");
+            esperar(2); // Pequena pausa pra ler o erro
+            continue; // Pula pro próximo loop, ignora o comando
+        }
 
-            if (strcmp(comando, "ORBITA") == 0) {
-                executar_manobra(duracao_manobra);
-            }
-            else if (strcmp(comando, "BAIXAR") == 0) {
-                executar_downlink();
-            }
-            else if (strcmp(comando, "CARREGAR") == 0) {
-                bateria = 100;
-                strcpy(status_sistema, "EM ORBITA (STANDBY)"); // Revive o sistema
-                printf("\n\033[1;32m[SISTEMA] Bateria recarregada manualmente.\033[0m\n");
-                sleep(1);
-            }
+        if (strcmp(comando, "ORBITA") == 0) {
+            executar_manobra(duracao_manobra);
+        }
+        else if (strcmp(comando, "BAIXAR") == 0) {
+            executar_downlink();
+        }
+        else if (strcmp(comando, "CARREGAR") == 0) {
+            bateria = 100;
+            strcpy(status_sistema, "EM ORBITA (STANDBY)"); // Revive o sistema
+            if (!modo_script) printf("\n");
+            registrar("\033[1;32m", "[SISTEMA] Bateria recarregada manualmente.");
+            esperar(1);
+        }
 
-            else if (strcmp(comando, "STATUS") == 0) {
-                imprimir_interface(); 
-            }
-            else if (strcmp(comando, "SAIR") == 0) {
-                simulacao_rodando = 0;
-            }
-            else {
-                printf("Comando desconhecido.\n");
-            }
+        else if (strcmp(comando, "STATUS") == 0) {
+            imprimir_interface(); 
         }
-        printf("\n");
+        else if (strcmp(comando, "SAIR") == 0) {
+            simulacao_rodando = 0;
+        }
+        else {
+            registrar("", "Comando desconhecido.");
+        }
+        if (!modo_script) printf("\n");
     }
 
-}
\ No newline at end of file
+    if (modo_script) {
+        char msg[200];
+        sprintf(msg, "FIM: BATERIA %d%% | TEMP %d C | %s", bateria, temperatura, status_sistema);
+        registrar("", msg);
+        double parede = (sim_monotonico_ns() - sim_t0_ns) / 1e9;
+        printf("[METRICAS] simulado %.1f s em %.3f s de parede (%.0fx)\n",
+               relogio_ns / 1e9, parede, parede > 0 ? relogio_ns / 1e9 / parede : 0.0);
+        sim_script_fechar(&roteiro);
+    }
+    despejar_histogramas(stdout);
+    if (roteiro_erro) {
+        fprintf(stderr, "roteiro:%d: simulação interrompida por erro de formato\n", roteiro_erro);
+        return 1;
+    }
+    return 0;
+}
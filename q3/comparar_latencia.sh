@@ -0,0 +1,46 @@
+#!/bin/bash
+#chmod +x comparar_latencia.sh
+#./comparar_latencia.sh >> resultados_latencia.txt
+# Roda o mesmo roteiro no simulador sequencial e no paralelo, no relógio
+# real, e imprime os histogramas de latência dos dois (linhas [HIST]).
+# Demora o tempo do roteiro (~40 s) em cada simulador.
+# --- 1. Compilação ---
+echo "Compilando os programas..."
+gcc -Wall -Wextra -O2 agc_simulator_sequencial.c -o agc_seq
+gcc -Wall -Wextra -O2 -pthread agc_simulator_paralelo.c -o agc_par
+
+# Verifica se compilou
+if [[ ! -f "./agc_seq" ]] || [[ ! -f "./agc_par" ]]; then
+    echo "Erro na compilação!"
+    exit 1
+fi
+
+# --- 2. Roteiro ---
+# Comandos chegando enquanto uma manobra ou transmissão ainda está rodando
+ROTEIRO=$(mktemp)
+cat > "$ROTEIRO" <<'FIM'
+0    ORBITA
+2    STATUS
+4    BAIXAR
+6    STATUS
+8    CARREGAR
+12   BAIXAR
+13   STATUS
+20   ORBITA
+22   STATUS
+25   BAIXAR
+30   STATUS
+40   SAIR
+FIM
+
+# Quantidade de monitores do paralelo
+THREADS=${THREADS:-16}
+
+# --- 3. Execução ---
+echo "== SEQUENCIAL =="
+./agc_seq --script "$ROTEIRO" | grep '^\[HIST\]'
+echo "== PARALELO ($THREADS monitores) =="
+./agc_par --seed 1 --threads "$THREADS" --script "$ROTEIRO" | grep '^\[HIST\]'
+
+rm -f "$ROTEIRO"
+echo "Testes finalizados!"
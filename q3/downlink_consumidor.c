@@ -0,0 +1,139 @@
+// gcc -Wall -Wextra -O2 downlink_consumidor.c -o downlink_cons
+// ./downlink_cons [segundos] [nome_shm]
+//
+// Estação de solo local: lê os quadros que o simulador (./agc_par --downlink)
+// publica no anel em memória compartilhada (downlink_frame.h) e mede, a cada
+// segundo e no total, quadros/s, quadros perdidos (buracos na sequência) e
+// latência ponta a ponta (publicação -> leitura, mesmo CLOCK_MONOTONIC).
+// Sem 'segundos' roda até Ctrl-C.
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+#include "downlink_frame.h"
+
+static volatile sig_atomic_t parar = 0;
+
+static void ao_sinal(int sig) {
+    (void) sig;
+    parar = 1;
+}
+
+static int cmp_u64(const void *a, const void *b) {
+    uint64_t x = *(const uint64_t *) a, y = *(const uint64_t *) b;
+    return (x > y) - (x < y);
+}
+
+// Latências de um período; ordena no relatório
+typedef struct {
+    uint64_t *v;
+    size_t n, cap;
+} amostras_t;
+
+static void amostras_add(amostras_t *a, uint64_t x) {
+    if (a->n == a->cap) {
+        size_t cap = a->cap ? 2 * a->cap : 4096;
+        uint64_t *novo = realloc(a->v, cap * sizeof(uint64_t));
+        if (!novo) return; // sem memória: a amostra fica de fora
+        a->v = novo;
+        a->cap = cap;
+    }
+    a->v[a->n++] = x;
+}
+
+static void relatar(const char *rotulo, amostras_t *lat, double dt, uint64_t quadros, uint64_t perdidos) {
+    if (lat->n > 0) qsort(lat->v, lat->n, sizeof(uint64_t), cmp_u64);
+    printf("%s quadros %lu; fps %.0f; perdidos %lu; latencia us p50 %.1f, p99 %.1f, max %.1f\n",
+           rotulo, (unsigned long) quadros, dt > 0 ? quadros / dt : 0.0, (unsigned long) perdidos,
+           lat->n ? lat->v[lat->n / 2] / 1e3 : 0.0,
+           lat->n ? lat->v[(size_t) (lat->n * 0.99)] / 1e3 : 0.0,
+           lat->n ? lat->v[lat->n - 1] / 1e3 : 0.0);
+    fflush(stdout);
+}
+
+// Números gastos em [menor, maior] que não chegaram. Um quadro do intervalo
+// ainda a caminho também conta até chegar; nunca fica negativo.
+static uint64_t buracos(int tem_seq, uint64_t menor, uint64_t maior, uint64_t total) {
+    if (!tem_seq || total > maior - menor + 1) return 0;
+    return (maior - menor + 1) - total;
+}
+
+int main(int argc, char *argv[]) {
+    double duracao = argc >= 2 ? atof(argv[1]) : 0.0;
+    const char *nome = argc >= 3 ? argv[2] : DOWNLINK_NOME_PADRAO;
+
+    struct sigaction sa = {0};
+    sa.sa_handler = ao_sinal;
+    sigaction(SIGINT, &sa, NULL);
+    sigaction(SIGTERM, &sa, NULL);
+
+    // O simulador pode ainda não ter criado o segmento
+    downlink_anel_t anel = {0};
+    int avisou = 0;
+    while (downlink_abrir(&anel, nome, 0) != 0) {
+        if (parar) return 1;
+        if (!avisou) {
+            fprintf(stderr, "Aguardando o simulador criar %s...\n", nome);
+            avisou = 1;
+        }
+        usleep(100000);
+    }
+
+    uint64_t inicio = downlink_agora_ns(), periodo = inicio;
+    uint64_t total = 0, no_periodo = 0;
+    uint64_t menor_seq = 0, maior_seq = 0, fora_de_ordem = 0;
+    uint64_t perdidos_antes = 0;
+    int tem_seq = 0;
+    amostras_t lat_periodo = {0}, lat_total = {0};
+
+    while (!parar) {
+        const downlink_frame_t *f = downlink_espiar(&anel);
+        if (f) {
+            uint64_t agora = downlink_agora_ns();
+            uint64_t lat = agora > f->timestamp_ns ? agora - f->timestamp_ns : 0;
+            if (!tem_seq) {
+                menor_seq = maior_seq = f->seq;
+                tem_seq = 1;
+            } else if (f->seq > maior_seq) {
+                maior_seq = f->seq;
+            } else {
+                fora_de_ordem++; // produtores numeram antes de reservar o slot
+                if (f->seq < menor_seq) menor_seq = f->seq; // chegou depois do primeiro lido
+            }
+            downlink_liberar(&anel);
+            amostras_add(&lat_periodo, lat);
+            amostras_add(&lat_total, lat);
+            total++;
+            no_periodo++;
+        } else {
+            downlink_esperar(&anel, 100);
+        }
+
+        uint64_t agora = downlink_agora_ns();
+        if (agora - periodo >= 1000000000ULL) {
+            // Buracos = números gastos que não chegaram (descartados no produtor)
+            uint64_t perdidos = buracos(tem_seq, menor_seq, maior_seq, total);
+            // (pode encolher se um quadro atrasado fechar um buraco do período anterior)
+            uint64_t novos = perdidos > perdidos_antes ? perdidos - perdidos_antes : 0;
+            relatar("[DOWNLINK]", &lat_periodo, (agora - periodo) / 1e9, no_periodo, novos);
+            perdidos_antes = perdidos;
+            lat_periodo.n = 0;
+            no_periodo = 0;
+            periodo = agora;
+        }
+        if (duracao > 0 && (agora - inicio) / 1e9 >= duracao) break;
+    }
+
+    double dt = (downlink_agora_ns() - inicio) / 1e9;
+    uint64_t perdidos = buracos(tem_seq, menor_seq, maior_seq, total);
+    relatar("[DOWNLINK] TOTAL", &lat_total, dt, total, perdidos);
+    printf("[DOWNLINK] produtor: %lu publicados, %lu descartados (anel cheio); %lu fora de ordem\n",
+           (unsigned long) atomic_load(&anel.cab->publicados),
+           (unsigned long) atomic_load(&anel.cab->descartados), (unsigned long) fora_de_ordem);
+
+    free(lat_periodo.v);
+    free(lat_total.v);
+    downlink_fechar(&anel, nome, 0);
+    return 0;
+}
@@ -0,0 +1,201 @@
+// Downlink binário: quadros de telemetria de tamanho fixo num anel em
+// memória compartilhada (shm_open), lido por outro processo sem cópia.
+//
+// Vários produtores (threads do simulador) reservam slots com CAS na cauda,
+// no esquema de Vyukov do log: cada slot tem um número de sequência que diz
+// se está livre (== posição) ou pronto para o consumidor (== posição + 1).
+// O quadro é escrito direto no slot. Se o anel está cheio o quadro é
+// descartado e contado; o número de sequência do quadro já foi gasto, então
+// o consumidor enxerga o buraco. Um único consumidor avança a cabeça e, sem
+// nada para ler, dorme num futex que os produtores só acordam se ele avisou
+// que está esperando.
+#ifndef DOWNLINK_FRAME_H
+#define DOWNLINK_FRAME_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdatomic.h>
+#include <string.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+
+#define DOWNLINK_NOME_PADRAO "/agc_downlink"
+#define DOWNLINK_MAGICA 0x41474344u // "AGCD"
+#define DOWNLINK_VERSAO 1
+#define DOWNLINK_CAPACIDADE 65536   // quadros, potência de 2
+
+enum { DOWNLINK_ORIGEM_RADIO = 0, DOWNLINK_ORIGEM_MONITOR = 1 };
+
+// Quadro no fio: 24 bytes, sem ponteiros, mesma disposição nos dois lados
+typedef struct {
+    uint64_t timestamp_ns; // CLOCK_MONOTONIC na publicação (latência ponta a ponta)
+    uint64_t seq;          // global e contínuo; buraco = quadro perdido
+    int16_t bateria;
+    int16_t temperatura;
+    uint8_t status;        // código STATUS_* do simulador
+    uint8_t origem;        // DOWNLINK_ORIGEM_*
+    uint16_t reservado;
+} downlink_frame_t;
+
+_Static_assert(sizeof(downlink_frame_t) == 24, "quadro do downlink mudou de tamanho");
+
+typedef struct {
+    _Atomic uint64_t seq_slot;
+    downlink_frame_t frame;
+} downlink_slot_t;
+
+// Cabeçalho do segmento; produtores e consumidor em linhas de cache separadas
+typedef struct {
+    uint32_t magica;
+    uint32_t versao;
+    uint32_t capacidade;
+    uint32_t tam_frame;
+    char pad0[48];
+    _Atomic uint64_t cauda;        // produtores
+    _Atomic uint64_t proximo_seq;
+    _Atomic uint64_t publicados;
+    _Atomic uint64_t descartados;  // anel cheio
+    _Atomic uint32_t sinal;        // palavra do futex
+    _Atomic uint32_t esperando;    // 1 = consumidor dormindo ou indo dormir
+    char pad1[24];
+    _Atomic uint64_t cabeca;       // consumidor
+    char pad2[56];
+} downlink_cabecalho_t;
+
+typedef struct {
+    downlink_cabecalho_t *cab;
+    downlink_slot_t *slots;
+    size_t tamanho;
+} downlink_anel_t;
+
+static inline uint64_t downlink_agora_ns(void) {
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return (uint64_t) t.tv_sec * 1000000000ULL + (uint64_t) t.tv_nsec;
+}
+
+// Cria (produtor) ou abre (consumidor) o segmento. Devolve 0 ou -1.
+// Criar recomeça o anel do zero; abrir confere mágica e versão.
+static inline int downlink_abrir(downlink_anel_t *a, const char *nome, int criar) {
+    size_t tamanho = sizeof(downlink_cabecalho_t) + (size_t) DOWNLINK_CAPACIDADE * sizeof(downlink_slot_t);
+    if (criar) shm_unlink(nome); // consumidores antigos ficam com o segmento velho
+    int fd = shm_open(nome, criar ? (O_RDWR | O_CREAT | O_EXCL) : O_RDWR, 0600);
+    if (fd < 0) return -1;
+    if (criar && ftruncate(fd, (off_t) tamanho) != 0) {
+        close(fd);
+        return -1;
+    }
+    // Entre o shm_open e o ftruncate do produtor o segmento tem 0 bytes, e
+    // ler a mágica dele daria SIGBUS: o consumidor só mapeia quando o
+    // tamanho já está certo (senão falha e o chamador tenta de novo)
+    struct stat st;
+    if (!criar && (fstat(fd, &st) != 0 || (size_t) st.st_size < tamanho)) {
+        close(fd);
+        return -1;
+    }
+    void *p = mmap(NULL, tamanho, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (p == MAP_FAILED) return -1;
+
+    a->cab = (downlink_cabecalho_t *) p;
+    a->slots = (downlink_slot_t *) ((char *) p + sizeof(downlink_cabecalho_t));
+    a->tamanho = tamanho;
+    if (criar) {
+        for (uint64_t i = 0; i < DOWNLINK_CAPACIDADE; i++) atomic_init(&a->slots[i].seq_slot, i);
+        a->cab->capacidade = DOWNLINK_CAPACIDADE;
+        a->cab->tam_frame = sizeof(downlink_frame_t);
+        a->cab->versao = DOWNLINK_VERSAO;
+        atomic_thread_fence(memory_order_release);
+        a->cab->magica = DOWNLINK_MAGICA; // por último: o segmento está pronto
+    } else if (a->cab->magica != DOWNLINK_MAGICA || a->cab->versao != DOWNLINK_VERSAO ||
+               a->cab->capacidade != DOWNLINK_CAPACIDADE || a->cab->tam_frame != sizeof(downlink_frame_t)) {
+        munmap(p, tamanho);
+        return -1;
+    }
+    return 0;
+}
+
+static inline void downlink_fechar(downlink_anel_t *a, const char *nome, int remover) {
+    if (a->cab) munmap(a->cab, a->tamanho);
+    a->cab = NULL;
+    if (remover) shm_unlink(nome);
+}
+
+// Produtor: numera, carimba e copia o quadro direto no slot. Nunca bloqueia;
+// devolve 0 se publicou, -1 se descartou (anel cheio).
+static inline int downlink_publicar(downlink_anel_t *a, int bateria, int temperatura, int status, int origem) {
+    downlink_cabecalho_t *c = a->cab;
+    uint64_t seq = atomic_fetch_add_explicit(&c->proximo_seq, 1, memory_order_relaxed);
+    uint64_t pos = atomic_load_explicit(&c->cauda, memory_order_relaxed);
+    downlink_slot_t *s;
+    for (;;) {
+        s = &a->slots[pos & (DOWNLINK_CAPACIDADE - 1)];
+        uint64_t seq_slot = atomic_load_explicit(&s->seq_slot, memory_order_acquire);
+        int64_t dif = (int64_t) seq_slot - (int64_t) pos;
+        if (dif == 0) {
+            if (atomic_compare_exchange_weak_explicit(&c->cauda, &pos, pos + 1,
+                                                      memory_order_relaxed, memory_order_relaxed))
+                break;
+        } else if (dif < 0) {
+            atomic_fetch_add_explicit(&c->descartados, 1, memory_order_relaxed);
+            return -1;
+        } else {
+            pos = atomic_load_explicit(&c->cauda, memory_order_relaxed);
+        }
+    }
+    s->frame.seq = seq;
+    s->frame.bateria = (int16_t) bateria;
+    s->frame.temperatura = (int16_t) temperatura;
+    s->frame.status = (uint8_t) status;
+    s->frame.origem = (uint8_t) origem;
+    s->frame.reservado = 0;
+    s->frame.timestamp_ns = downlink_agora_ns();
+    atomic_store_explicit(&s->seq_slot, pos + 1, memory_order_release);
+    atomic_fetch_add_explicit(&c->publicados, 1, memory_order_relaxed);
+
+    // Par da cerca em downlink_esperar: ou o consumidor vê o quadro ao
+    // conferir de novo, ou este produtor vê que ele vai dormir
+    atomic_thread_fence(memory_order_seq_cst);
+    if (atomic_load_explicit(&c->esperando, memory_order_relaxed)) {
+        atomic_fetch_add_explicit(&c->sinal, 1, memory_order_seq_cst);
+        syscall(SYS_futex, &c->sinal, FUTEX_WAKE, 1, NULL, NULL, 0);
+    }
+    return 0;
+}
+
+// Consumidor: o próximo quadro pronto, lido no lugar (NULL se vazio).
+// Chame downlink_liberar depois de usar o quadro.
+static inline const downlink_frame_t *downlink_espiar(downlink_anel_t *a) {
+    uint64_t pos = atomic_load_explicit(&a->cab->cabeca, memory_order_relaxed);
+    downlink_slot_t *s = &a->slots[pos & (DOWNLINK_CAPACIDADE - 1)];
+    if (atomic_load_explicit(&s->seq_slot, memory_order_acquire) != pos + 1) return NULL;
+    return &s->frame;
+}
+
+static inline void downlink_liberar(downlink_anel_t *a) {
+    uint64_t pos = atomic_load_explicit(&a->cab->cabeca, memory_order_relaxed);
+    downlink_slot_t *s = &a->slots[pos & (DOWNLINK_CAPACIDADE - 1)];
+    atomic_store_explicit(&s->seq_slot, pos + DOWNLINK_CAPACIDADE, memory_order_release);
+    atomic_store_explicit(&a->cab->cabeca, pos + 1, memory_order_release);
+}
+
+// Consumidor sem nada para ler: dorme até um produtor publicar ou até
+// 'timeout_ms'. Avisa antes de conferir de novo, para não perder o wake.
+static inline void downlink_esperar(downlink_anel_t *a, int timeout_ms) {
+    downlink_cabecalho_t *c = a->cab;
+    uint32_t v = atomic_load_explicit(&c->sinal, memory_order_seq_cst);
+    atomic_store_explicit(&c->esperando, 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_seq_cst);
+    if (!downlink_espiar(a)) {
+        struct timespec ts = { timeout_ms / 1000, (long) (timeout_ms % 1000) * 1000000L };
+        syscall(SYS_futex, &c->sinal, FUTEX_WAIT, v, &ts, NULL, 0);
+    }
+    atomic_store_explicit(&c->esperando, 0, memory_order_relaxed);
+}
+
+#endif
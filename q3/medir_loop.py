@@ -0,0 +1,95 @@
+#!/usr/bin/env python3
+# Mede o custo do laço principal do simulador num pseudo-terminal:
+#  - uso de CPU e acordadas/s do processo ocioso (sem comandos) por alguns segundos
+#  - latência comando -> resposta do STATUS (do ENTER até o painel aparecer)
+#
+# Uso: python3 medir_loop.py ./agc_par [threads] [segundos_ocioso] [n_comandos]
+import os
+import pty
+import select
+import sys
+import time
+
+
+def cpu_e_acordadas(pid):
+    """Soma, em todas as threads, o tempo de CPU (ns, schedstat) e as trocas
+    de contexto voluntárias (cada uma é uma acordada depois de dormir)."""
+    cpu_ns, acordadas = 0, 0
+    for tid in os.listdir(f"/proc/{pid}/task"):
+        try:
+            with open(f"/proc/{pid}/task/{tid}/schedstat") as f:
+                cpu_ns += int(f.read().split()[0])
+            with open(f"/proc/{pid}/task/{tid}/status") as f:
+                for linha in f:
+                    if linha.startswith("voluntary_ctxt_switches"):
+                        acordadas += int(linha.split()[1])
+        except FileNotFoundError:
+            pass  # thread terminou entre o listdir e a leitura
+    return cpu_ns / 1e9, acordadas
+
+
+def ler_ate(fd, marcador, timeout=10.0):
+    buf = b""
+    limite = time.monotonic() + timeout
+    while marcador not in buf:
+        resto = limite - time.monotonic()
+        if resto <= 0:
+            raise TimeoutError(marcador)
+        r, _, _ = select.select([fd], [], [], resto)
+        if r:
+            buf += os.read(fd, 4096)
+    return buf
+
+
+def main():
+    if len(sys.argv) < 2:
+        print("Uso: medir_loop.py <binario> [threads] [segundos_ocioso] [n_comandos]")
+        sys.exit(2)
+    binario = sys.argv[1]
+    threads = sys.argv[2] if len(sys.argv) > 2 else "4"
+    ocioso = float(sys.argv[3]) if len(sys.argv) > 3 else 5.0
+    n_cmd = int(sys.argv[4]) if len(sys.argv) > 4 else 50
+
+    pid, fd = pty.fork()
+    if pid == 0:
+        os.execv(binario, [binario])
+
+    ler_ate(fd, b"monitoramento?")
+    os.write(fd, threads.encode() + b"\n")
+    ler_ate(fd, b"COMANDO > ")
+
+    # CPU ociosa: nenhuma entrada, telemetria rodando normalmente
+    (c0, a0), t0 = cpu_e_acordadas(pid), time.monotonic()
+    fim = t0 + ocioso
+    while time.monotonic() < fim:
+        r, _, _ = select.select([fd], [], [], fim - time.monotonic())
+        if r:
+            os.read(fd, 4096)  # drena logs para o processo não bloquear
+    (c1, a1), t1 = cpu_e_acordadas(pid), time.monotonic()
+
+    # Latência: digita STATUS, marca o tempo no ENTER, espera o painel
+    lat = []
+    for _ in range(n_cmd):
+        os.write(fd, b"STATUS")
+        ler_ate(fd, b"STATUS")
+        inicio = time.monotonic()
+        os.write(fd, b"\n")
+        ler_ate(fd, b"COMANDOS:")
+        lat.append((time.monotonic() - inicio) * 1e3)
+        time.sleep(0.01)
+
+    os.write(fd, b"SAIR\n")
+    try:
+        os.waitpid(pid, 0)
+    except ChildProcessError:
+        pass
+
+    lat.sort()
+    print(f"cpu_ocioso: {100.0 * (c1 - c0) / (t1 - t0):.3f}% ({c1 - c0:.4f} s em {t1 - t0:.1f} s); "
+          f"acordadas/s: {(a1 - a0) / (t1 - t0):.1f}")
+    print(f"latencia_ms: media {sum(lat) / len(lat):.3f}; p50 {lat[len(lat) // 2]:.3f}; "
+          f"p99 {lat[min(len(lat) - 1, int(len(lat) * 0.99))]:.3f}; max {lat[-1]:.3f}")
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,40 @@
+#!/bin/bash
+#chmod +x run_constelacao.sh
+#./run_constelacao.sh >> resultados_constelacao.txt
+# Com repetições:
+#REPETICOES=10 ./run_constelacao.sh >> resultados_constelacao.txt
+# Outra semente (padrão 1; com REPETICOES > 1 cada repetição usa SEMENTE + rep - 1):
+#SEMENTE=7 ./run_constelacao.sh >> resultados_constelacao.txt
+# --- 1. Compilação ---
+echo "Compilando o simulador..."
+gcc -Wall -Wextra -O2 -pthread agc_simulator_paralelo.c -o agc_par
+
+# Verifica se compilou
+if [[ ! -f "./agc_par" ]]; then
+    echo "Erro na compilação!"
+    exit 1
+fi
+
+echo "Iniciando os testes..."
+
+# --- 2. Definição dos Parâmetros ---
+# Tamanho da constelação
+SATELITES=(1 10 100 1000 10000 100000)
+# Quantidade de workers
+THREADS=(1 2 4 8)
+
+# Quantas vezes cada configuração roda
+REPETICOES=${REPETICOES:-1}
+SEMENTE=${SEMENTE:-1}
+
+# --- 3. Execução ---
+# O número de ticks é escolhido pelo programa (~50M satélite-ticks por ponto)
+for rep in $(seq 1 "$REPETICOES"); do
+for n in "${SATELITES[@]}"; do
+    for t in "${THREADS[@]}"; do
+        ./agc_par --constelacao $n $t 0 $((SEMENTE + rep - 1))
+    done
+done
+done
+
+echo "Testes finalizados!"
@@ -0,0 +1,214 @@
+// Relógio de simulação, roteiro de comandos e fila de eventos, comuns aos
+// dois simuladores.
+//
+// Tempo de simulação = ns desde o início. No modo real ele segue o relógio
+// monotônico; no modo virtual (--virtual) só anda quando o laço de eventos
+// pula para o próximo evento, então dias de operação rodam em segundos.
+//
+// Roteiro (--script): uma linha por comando, "<segundos> <COMANDO>", em
+// ordem não decrescente de tempo; linhas vazias e iniciadas por '#' são
+// ignoradas. Ex.:
+//   0      ORBITA
+//   45.5   BAIXAR
+//   86400  SAIR
+#ifndef SIMULACAO_H
+#define SIMULACAO_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <errno.h>
+#include <time.h>
+
+#define SIM_NS_POR_S 1000000000UL
+
+// --- RELÓGIO ---
+static int sim_virtual = 0;
+static unsigned long sim_virtual_ns = 0; // só anda no modo virtual
+static unsigned long sim_t0_ns = 0;      // origem no relógio monotônico
+
+static inline unsigned long sim_monotonico_ns(void) {
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return (unsigned long) t.tv_sec * SIM_NS_POR_S + t.tv_nsec;
+}
+
+// Começa o relógio no instante 't' (0 numa simulação nova; o instante do
+// checkpoint numa restauração)
+static inline void sim_iniciar_em(int virtual_, unsigned long t) {
+    sim_virtual = virtual_;
+    sim_virtual_ns = t;
+    sim_t0_ns = sim_monotonico_ns() - t;
+}
+
+// Marca o instante zero da simulação
+static inline void sim_iniciar(int virtual_) {
+    sim_iniciar_em(virtual_, 0);
+}
+
+static inline unsigned long sim_agora_ns(void) {
+    return sim_virtual ? sim_virtual_ns : sim_monotonico_ns() - sim_t0_ns;
+}
+
+// Bloqueia até o instante 't' da simulação (no virtual, só avança o relógio)
+static inline void sim_dormir_ate(unsigned long t) {
+    if (sim_virtual) {
+        if (t > sim_virtual_ns) sim_virtual_ns = t;
+        return;
+    }
+    unsigned long alvo = sim_t0_ns + t;
+    struct timespec ts = { (time_t) (alvo / SIM_NS_POR_S), (long) (alvo % SIM_NS_POR_S) };
+    while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) == EINTR);
+}
+
+static inline void sim_dormir(unsigned segundos) {
+    sim_dormir_ate(sim_agora_ns() + segundos * SIM_NS_POR_S);
+}
+
+// --- GERADOR ALEATÓRIO ---
+// xorshift64* semeado por splitmix64; cada fluxo (monitor, uso) tem o seu,
+// então a sequência não depende de qual thread sorteia primeiro.
+typedef struct {
+    uint64_t s;
+} sim_rng_t;
+
+static inline void sim_rng_semear(sim_rng_t *r, uint64_t semente, uint64_t fluxo) {
+    uint64_t z = semente + (fluxo + 1) * 0x9E3779B97F4A7C15ULL;
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    z ^= z >> 31;
+    r->s = z ? z : 1;
+}
+
+static inline uint64_t sim_rng_proximo(sim_rng_t *r) {
+    r->s ^= r->s >> 12;
+    r->s ^= r->s << 25;
+    r->s ^= r->s >> 27;
+    return r->s * 0x2545F4914F6CDD1DULL;
+}
+
+// Inteiro em [0, n)
+static inline int sim_rng_faixa(sim_rng_t *r, int n) {
+    return (int) ((sim_rng_proximo(r) >> 33) % (uint64_t) n);
+}
+
+// --- ROTEIRO ---
+typedef struct {
+    FILE *f;
+    int linha;
+    int tem;                 // 1 = 'comando' e 'tempo_ns' valem
+    unsigned long tempo_ns;
+    char comando[256];
+} sim_script_t;
+
+// Lê o próximo comando. Devolve 1 se leu, 0 no fim e -1 em erro de formato.
+static inline int sim_script_avancar(sim_script_t *s) {
+    char buf[300];
+    unsigned long anterior = s->tempo_ns;
+    s->tem = 0;
+    while (fgets(buf, sizeof(buf), s->f)) {
+        s->linha++;
+        buf[strcspn(buf, "\r\n")] = '\0';
+        char *p = buf;
+        while (*p == ' ' || *p == '\t') p++;
+        if (*p == '\0' || *p == '#') continue;
+
+        char *fim;
+        double seg = strtod(p, &fim);
+        if (fim == p || seg < 0 || (*fim != ' ' && *fim != '\t')) {
+            fprintf(stderr, "roteiro:%d: esperado \"<segundos> <COMANDO>\"\n", s->linha);
+            return -1;
+        }
+        while (*fim == ' ' || *fim == '\t') fim++;
+        s->tempo_ns = (unsigned long) (seg * 1e9 + 0.5);
+        if (s->tempo_ns < anterior) {
+            fprintf(stderr, "roteiro:%d: tempo volta para trás\n", s->linha);
+            return -1;
+        }
+        snprintf(s->comando, sizeof(s->comando), "%s", fim);
+        s->tem = 1;
+        return 1;
+    }
+    return 0;
+}
+
+// Abre o roteiro e já deixa o primeiro comando carregado
+static inline int sim_script_abrir(sim_script_t *s, const char *caminho) {
+    memset(s, 0, sizeof(*s));
+    s->f = fopen(caminho, "r");
+    if (!s->f) {
+        perror(caminho);
+        return -1;
+    }
+    return sim_script_avancar(s) < 0 ? -1 : 0;
+}
+
+static inline void sim_script_fechar(sim_script_t *s) {
+    if (s->f) fclose(s->f);
+    s->f = NULL;
+}
+
+// --- FILA DE EVENTOS ---
+// Heap mínimo por (tempo, seq): eventos no mesmo instante saem na ordem em
+// que foram agendados. 'tipo' e 'indice' são do programa.
+typedef struct {
+    unsigned long tempo_ns;
+    unsigned long seq;
+    int tipo;
+    int indice;
+} sim_evento_t;
+
+typedef struct {
+    sim_evento_t *itens;
+    int n, cap;
+    unsigned long seq;
+} sim_fila_t;
+
+static inline int sim_evento_antes(const sim_evento_t *a, const sim_evento_t *b) {
+    if (a->tempo_ns != b->tempo_ns) return a->tempo_ns < b->tempo_ns;
+    return a->seq < b->seq;
+}
+
+static inline int sim_fila_inserir(sim_fila_t *q, unsigned long tempo_ns, int tipo, int indice) {
+    if (q->n == q->cap) {
+        int cap = q->cap ? 2 * q->cap : 64;
+        sim_evento_t *novo = realloc(q->itens, (size_t) cap * sizeof(sim_evento_t));
+        if (!novo) return -1;
+        q->itens = novo;
+        q->cap = cap;
+    }
+    int i = q->n++;
+    q->itens[i] = (sim_evento_t) { tempo_ns, q->seq++, tipo, indice };
+    while (i > 0 && sim_evento_antes(&q->itens[i], &q->itens[(i - 1) / 2])) {
+        sim_evento_t t = q->itens[i];
+        q->itens[i] = q->itens[(i - 1) / 2];
+        q->itens[(i - 1) / 2] = t;
+        i = (i - 1) / 2;
+    }
+    return 0;
+}
+
+static inline sim_evento_t sim_fila_remover(sim_fila_t *q) {
+    sim_evento_t topo = q->itens[0];
+    q->itens[0] = q->itens[--q->n];
+    for (int i = 0;;) {
+        int menor = i, e = 2 * i + 1, d = 2 * i + 2;
+        if (e < q->n && sim_evento_antes(&q->itens[e], &q->itens[menor])) menor = e;
+        if (d < q->n && sim_evento_antes(&q->itens[d], &q->itens[menor])) menor = d;
+        if (menor == i) break;
+        sim_evento_t t = q->itens[i];
+        q->itens[i] = q->itens[menor];
+        q->itens[menor] = t;
+        i = menor;
+    }
+    return topo;
+}
+
+static inline void sim_fila_liberar(sim_fila_t *q) {
+    free(q->itens);
+    q->itens = NULL;
+    q->n = q->cap = 0;
+}
+
+#endif